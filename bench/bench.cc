@@ -0,0 +1,218 @@
+/*
+ * File:        bench.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+//
+// The benchmarks of fvm2d (make bench): the phases of a step timed in
+// isolation, and full steps, for a sweep of mesh sizes and thread counts.
+//
+//   ./fvm2d_bench [p.ini] [option=value ...] [section.key=value ...]
+//
+// options:
+//   sizes=40,64,128,256,512,1024   the meshes n x n
+//   threads=1,2,4                  default: 1, 2, 4, ... up to the number of cores
+//   steps=3                        full steps per repetition
+//   reps=3                         repetitions; the fastest is kept
+//   out=bench                      writes <out>.csv and <out>.json
+// section.key=value overrides p.ini as in an ensemble, e.g. solver.type=bicgstab.
+//
+// Every phase is reported with its wall time per call and the throughput
+// cells/s; for the full steps that is cells*steps/s.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <limits>
+#include <functional>
+#include "Parameters.h"
+#include "Ini_reader.h"
+#include "Mesh.h"
+#include "D.h"
+#include "BCs.h"
+#include "Solver.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+struct Bench_options {
+  string inp_file = "p.ini";
+  std::vector<int> sizes = {40, 64, 128, 256, 512, 1024};
+  std::vector<int> threads;
+  int steps = 3;
+  int reps = 3;
+  string out = "bench";
+  std::vector<std::pair<string, string>> overrides; // section.key, value
+};
+
+struct Bench_result {
+  int nx;
+  int ny;
+  int threads;
+  string phase;
+  double seconds; // per call
+};
+
+std::vector<int> parse_list(const string& s) {
+  std::vector<int> v;
+  std::istringstream ist(s);
+  string item;
+  while (std::getline(ist, item, ',')) v.push_back(std::stoi(item));
+  return v;
+}
+
+void parse_args(int argc, char** argv, Bench_options* op) {
+  for (int k = 1; k < argc; ++k) {
+    string arg = argv[k];
+    std::size_t eq = arg.find('=');
+
+    if (eq == string::npos) { op->inp_file = arg; continue; }
+
+    string key = arg.substr(0, eq), value = arg.substr(eq + 1);
+    if (key.find('.') != string::npos) op->overrides.push_back({key, value});
+    else if (key == "sizes") op->sizes = parse_list(value);
+    else if (key == "threads") op->threads = parse_list(value);
+    else if (key == "steps") op->steps = std::stoi(value);
+    else if (key == "reps") op->reps = std::stoi(value);
+    else if (key == "out") op->out = value;
+    else {
+      std::cerr << "fvm2d_bench: unknown option " << key << std::endl;
+      exit(1);
+    }
+  }
+
+  if (op->threads.empty()) {
+    int nmax = 1;
+#ifdef _OPENMP
+    nmax = omp_get_num_procs();
+#endif
+    for (int t = 1; t < nmax; t *= 2) op->threads.push_back(t);
+    op->threads.push_back(nmax);
+  }
+  assert(op->steps > 0 && op->reps > 0);
+}
+
+// the fastest of reps calls of f, in seconds
+double time_min(int reps, const std::function<void()>& f) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < reps; ++r) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+  }
+  return best;
+}
+
+}
+
+//
+// The phases of Solver::update, called one by one on a Solver; a friend
+// of Solver.
+//
+class Solver_bench {
+  public:
+    static void run(Solver& s, int reps, int steps, std::vector<std::pair<string, double>>* timesp) {
+      std::vector<std::pair<string, double>>& times = *timesp;
+      double dt = s.m.dt();
+      Eigen::VectorXd x;
+
+      times.push_back({"construct_alpha_osf", time_min(reps, [&] { s.construct_alpha_osf(); })});
+      times.push_back({"update_vertex_f", time_min(reps, [&] { s.update_vertex_f(); })});
+
+      s.update_mass(dt);
+      s.set_history(dt);
+      s.f_lin_ = &s.f_;
+      times.push_back({"assemble", time_min(reps, [&] { s.R_.setZero(); s.assemble(); })});
+
+      times.push_back({"analyze", time_min(reps, [&] { s.lsolver_->analyze(s.M_); })});
+      times.push_back({"factorize", time_min(reps, [&] { s.lsolver_->factorize(s.M_); })});
+      times.push_back({"solve", time_min(reps, [&] { x = s.f_.reshaped(); s.lsolver_->solve(s.R_, &x); })});
+
+      s.save_pattern(); // analyzed above
+      double t = time_min(reps, [&] { for (int k = 0; k < steps; ++k) s.update(dt); });
+      times.push_back({"step", t / steps});
+    }
+};
+
+int main(int argc, char** argv) {
+  Bench_options op;
+  parse_args(argc, argv, &op);
+
+  std::vector<Bench_result> results;
+
+  std::cout << std::setw(6) << "nx" << std::setw(6) << "ny" << std::setw(8) << "threads"
+    << std::setw(22) << "phase" << std::setw(14) << "seconds" << std::setw(14) << "cells/s" << std::endl;
+
+  for (int n : op.sizes) {
+    Ini_reader ireader(op.inp_file);
+    mINI::INIStructure& ini = ireader.ini;
+
+    for (const auto& o : op.overrides) {
+      std::size_t dot = o.first.find('.');
+      ini[o.first.substr(0, dot)][o.first.substr(dot + 1)] = o.second;
+    }
+    ini["basic"]["run_id"] = "bench";
+    ini["basic"]["nalpha0"] = std::to_string(n);
+    ini["basic"]["nE"] = std::to_string(n);
+
+    Parameters paras(op.inp_file, &ireader);
+
+    for (int nt : op.threads) {
+#ifdef _OPENMP
+      omp_set_num_threads(nt);
+#endif
+      std::vector<std::pair<string, double>> times;
+      std::unique_ptr<Mesh> mp;
+      std::unique_ptr<D> dp;
+
+      times.push_back({"mesh", time_min(op.reps, [&] { mp.reset(new Mesh(paras)); })});
+      dp.reset(new D(paras, *mp));
+      times.push_back({"constructD", time_min(op.reps, [&] { dp->constructD(paras, 0.0); })});
+
+      BCs bcs(paras);
+      std::unique_ptr<Solver> sp;
+      times.push_back({"solver_setup", time_min(1, [&] { sp.reset(new Solver(paras, *mp, *dp, bcs)); })});
+
+      Solver_bench::run(*sp, op.reps, op.steps, &times);
+
+      for (const auto& t : times) {
+        results.push_back({n, n, nt, t.first, t.second});
+        std::cout << std::setw(6) << n << std::setw(6) << n << std::setw(8) << nt
+          << std::setw(22) << t.first << std::setw(14) << t.second
+          << std::setw(14) << n * (double)n / t.second << std::endl;
+      }
+    }
+  }
+
+  std::ofstream csv(op.out + ".csv");
+  assert(csv);
+  csv << "nx,ny,threads,phase,seconds,cells_per_s\n";
+  for (const auto& r : results)
+    csv << r.nx << "," << r.ny << "," << r.threads << "," << r.phase << "," << r.seconds
+      << "," << r.nx * (double)r.ny / r.seconds << "\n";
+
+  std::ofstream json(op.out + ".json");
+  assert(json);
+  json << "{\n  \"config\": \"" << op.inp_file << "\",\n  \"steps\": " << op.steps
+    << ",\n  \"reps\": " << op.reps << ",\n  \"results\": [\n";
+  for (std::size_t k = 0; k < results.size(); ++k) {
+    const Bench_result& r = results[k];
+    json << "    {\"nx\": " << r.nx << ", \"ny\": " << r.ny << ", \"threads\": " << r.threads
+      << ", \"phase\": \"" << r.phase << "\", \"seconds\": " << r.seconds
+      << ", \"cells_per_s\": " << r.nx * (double)r.ny / r.seconds << "}"
+      << (k + 1 < results.size() ? ",\n" : "\n");
+  }
+  json << "  ]\n}\n";
+
+  std::cout << "wrote " << op.out << ".csv and " << op.out << ".json" << std::endl;
+  return 0;
+}
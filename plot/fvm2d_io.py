@@ -0,0 +1,36 @@
+import numpy as np
+
+# Reader of the binary snapshots written by fvm2d (output_format = binary).
+# See source/Snapshot.h for the layout.
+
+SNAPSHOT_MAGIC = b'FVM2DSNP'
+SNAPSHOT_VERSION = 1
+HEADER_SIZE = 64
+
+_header_dtype = np.dtype([('magic', 'S8'), ('version', '<u4'), ('offset', '<u4'),
+                          ('nx', '<u8'), ('ny', '<u8'), ('step', '<i8'), ('t', '<f8'),
+                          ('reserved', 'V16')])
+
+def read_snapshot(fname):
+    """Map a snapshot file without copying.
+
+    Returns a dict with step, t, the cell centers a0 (radian) and logp,
+    and f of shape (nx, ny), indexed like the ASCII output f[i, j].
+    """
+    mm = np.memmap(fname, mode='r', dtype=np.uint8)
+    header = mm[:HEADER_SIZE].view(_header_dtype)[0]
+
+    if header['magic'] != SNAPSHOT_MAGIC or header['version'] != SNAPSHOT_VERSION:
+        raise ValueError(fname + ' is not a version %d fvm2d snapshot' % SNAPSHOT_VERSION)
+
+    nx, ny = int(header['nx']), int(header['ny'])
+    if header['offset'] != HEADER_SIZE + 8 * (nx + ny) or mm.size != header['offset'] + 8 * nx * ny:
+        raise ValueError(fname + ' has an inconsistent size')
+
+    data = mm[HEADER_SIZE:].view('<f8')
+
+    return {'step': int(header['step']),
+            't': float(header['t']),
+            'a0': data[:nx],
+            'logp': data[nx:nx + ny],
+            'f': data[nx + ny:].reshape((ny, nx)).T}
@@ -0,0 +1,46 @@
+import argparse
+import numpy as np
+
+# Writer of the polygon mesh files read by fvm2d (unstructured = 1 in p.ini).
+# See source/Poly_mesh.h for the format.
+
+def write_mesh(fname, vertices, cells):
+    """Write vertices, an (n, 2) array of fractions of the alpha0 and log(p)
+    ranges, and cells, a list of lists of vertex indices."""
+    with open(fname, 'w') as f:
+        f.write('# fvm2d polygon mesh\n')
+        f.write('%d %d\n' % (len(vertices), len(cells)))
+        for x, y in vertices:
+            f.write('%.17g %.17g\n' % (x, y))
+        for c in cells:
+            f.write('%d %s\n' % (len(c), ' '.join(str(v) for v in c)))
+
+def quad_mesh(nx, ny, skew=0.0, split=False):
+    """nx x ny quadrilaterals, with the inner grid lines bent by skew while
+    the boundary stays in place; with split, each quad is cut into two
+    triangles."""
+    x, y = np.meshgrid(np.linspace(0, 1, nx + 1), np.linspace(0, 1, ny + 1), indexing='ij')
+    xs = x + skew * np.sin(np.pi * x) * np.sin(np.pi * y) / np.pi
+    vertices = np.column_stack([xs.ravel(), y.ravel()])
+
+    v = lambda i, j: i * (ny + 1) + j
+    cells = []
+    for i in range(nx):
+        for j in range(ny):
+            a, b, c, d = v(i, j), v(i + 1, j), v(i + 1, j + 1), v(i, j + 1)
+            if split:
+                cells += [[a, b, c], [a, c, d]]
+            else:
+                cells.append([a, b, c, d])
+    return vertices, cells
+
+if __name__ == '__main__':
+    ap = argparse.ArgumentParser(description='Write a polygon mesh for fvm2d.')
+    ap.add_argument('nx', type=int)
+    ap.add_argument('ny', type=int)
+    ap.add_argument('-o', '--output', default='mesh.txt')
+    ap.add_argument('--skew', type=float, default=0.0, help='bend of the inner grid lines')
+    ap.add_argument('--split', action='store_true', help='triangles instead of quads')
+    args = ap.parse_args()
+
+    write_mesh(args.output, *quad_mesh(args.nx, args.ny, args.skew, args.split))
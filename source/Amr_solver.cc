@@ -0,0 +1,261 @@
+/*
+ * File:        Amr_solver.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#include <cassert>
+#include <limits>
+#include "Amr_solver.h"
+
+Amr_solver::Amr_solver(const Parameters& paras_in, const Mesh& m_in, const D& d_in, const BCs& bcs_in)
+  : paras(paras_in), m(m_in), d(d_in), bcs(bcs_in), tree_(m_in, paras_in.amr_max_level()), t_(0) {
+
+  lsolver_ = make_linear_solver(paras);
+
+  setup();
+  init_f();
+
+  // refine down to the initial condition
+  for (int l = 0; l < tree_.max_level(); ++l) {
+    if (!adapt()) break;
+    init_f();
+  }
+
+  update_vertex_f();
+}
+
+void Amr_solver::init_f() {
+  for (std::size_t k = 0; k < tree_.ncells(); ++k)
+    f_(k) = bcs.init_f(tree_.center(k)(0), std::exp(tree_.center(k)(1)));
+}
+
+void Amr_solver::setup() {
+  std::size_t n = tree_.ncells();
+
+  f_.conservativeResize(n);
+  R_.resize(n);
+  G_.resize(n);
+  tau_.resize(n);
+  Daa_.resize(n);
+  Dyy_.resize(n);
+  alpha_osf_.resize(tree_.nfaces());
+  vertex_f_.resize(tree_.nvertices());
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t k = 0; k < n; ++k) {
+    const Point& K = tree_.center(k);
+    double a0 = K(0);
+    double p = std::exp(K(1));
+    double daa, day, dyy;
+
+    d.at(a0, p, &daa, &day, &dyy);
+    Daa_(k) = daa;
+    Dyy_(k) = dyy;
+
+    Eigen::Matrix2d Lambda_K;
+    Lambda_K << daa * Solver::G(a0, p), day * Solver::G(a0, p),
+             day * Solver::G(a0, p), dyy * Solver::G(a0, p);
+
+    for (int h = tree_.face_begin(k); h < tree_.face_end(k); ++h) {
+      const Quadtree::Face& face = tree_.face(h);
+      Solver::alpha_osf_func(Lambda_K, K, face.A, face.B, &alpha_osf_[h]);
+    }
+
+    G_(k) = Solver::G(a0, p) * tree_.area(k);
+
+    if (a0 < paras.alpha0_lc())
+      tau_(k) = Solver::bounce_period(paras.L(), a0, p) / 4.0;
+    else
+      tau_(k) = std::numeric_limits<double>::max();
+  }
+
+  // inverse distance weights of the leaves around each vertex
+  vertex_w_.resize(tree_.vertex_end(tree_.nvertices() - 1));
+  for (std::size_t v = 0; v < tree_.nvertices(); ++v) {
+    double sum = 0;
+    for (int nn = tree_.vertex_begin(v); nn < tree_.vertex_end(v); ++nn) {
+      vertex_w_[nn] = 1.0 / (tree_.vertex(v) - tree_.center(tree_.vertex_cell(nn))).norm();
+      sum += vertex_w_[nn];
+    }
+    for (int nn = tree_.vertex_begin(v); nn < tree_.vertex_end(v); ++nn) vertex_w_[nn] /= sum;
+  }
+
+  // the sparsity pattern
+  std::vector<T> coeffs;
+  coeffs.reserve(n + tree_.nfaces());
+  for (std::size_t k = 0; k < n; ++k) {
+    coeffs.push_back(T(k, k, 0.0));
+    for (int h = tree_.face_begin(k); h < tree_.face_end(k); ++h)
+      if (tree_.face(h).nbr >= 0) coeffs.push_back(T(k, tree_.face(h).nbr, 0.0));
+  }
+
+  M_.resize(n, n);
+  M_.setFromTriplets(coeffs.begin(), coeffs.end());
+  M_.makeCompressed();
+
+  const double* val = M_.valuePtr();
+  diag_slot_.resize(n);
+  slot_.resize(tree_.nfaces());
+
+  for (std::size_t k = 0; k < n; ++k) {
+    diag_slot_(k) = &M_.coeffRef(k, k) - val;
+
+    for (int h = tree_.face_begin(k); h < tree_.face_end(k); ++h) {
+      const Quadtree::Face& face = tree_.face(h);
+
+      if (face.nbr >= 0)
+        slot_[h] = &M_.coeffRef(k, face.nbr) - val;
+      else if (face.side == m.inbr_ip()) // nothing special for alpha=90
+        slot_[h] = kSlotNone;
+      else if (face.side == m.inbr_im() && paras.alpha0_min_bct() == 0) // df/da0 = 0 at alpha0 = 0
+        slot_[h] = kSlotNone;
+      else
+        slot_[h] = kSlotDirbc;
+    }
+  }
+
+  analyzed_ = false;
+}
+
+// The boundary conditions at the vertices are those of Solver::update_vertex_f:
+// f is given at pmin and pmax, and at alpha0_min if alpha0_min_bct != 0.
+void Amr_solver::update_vertex_f() {
+  const int kIm = 1 << m.inbr_im(), kJp = 1 << m.inbr_jp(), kJm = 1 << m.inbr_jm();
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t v = 0; v < tree_.nvertices(); ++v) {
+    int sides = tree_.vertex_sides(v);
+    const Point& P = tree_.vertex(v);
+
+    if (sides & kJm) {
+      vertex_f_(v) = bcs.pmin(t_, P(0));
+    }
+    else if (sides & kJp) {
+      vertex_f_(v) = bcs.pmax(t_, P(0));
+    }
+    else if ((sides & kIm) && paras.alpha0_min_bct() != 0) {
+      vertex_f_(v) = bcs.alpha0_lc(t_, std::exp(P(1)));
+    }
+    else {
+      double fv = 0;
+      for (int nn = tree_.vertex_begin(v); nn < tree_.vertex_end(v); ++nn)
+        fv += vertex_w_[nn] * f_(tree_.vertex_cell(nn));
+      vertex_f_(v) = fv;
+    }
+  }
+}
+
+void Amr_solver::assemble(double dt) {
+  double* val = M_.valuePtr();
+  std::fill(val, val + M_.nonZeros(), 0.0);
+
+  // Each leaf only writes to its own row of M and R.
+  #pragma omp parallel for schedule(static)
+  for (std::size_t k = 0; k < tree_.ncells(); ++k) {
+    double R = 0.0;
+
+    for (int h = tree_.face_begin(k); h < tree_.face_end(k); ++h) {
+      const Quadtree::Face& face = tree_.face(h);
+      const NTPFA_node& aKs = alpha_osf_[h];
+      int slot = slot_[h];
+      if (slot == kSlotNone) continue;
+
+      double fA = vertex_f_(face.vA);
+      double fB = vertex_f_(face.vB);
+      double aK = aKs.A * fA + aKs.B * fB;
+
+      if (slot == kSlotDirbc) {
+        R += aK;
+        val[diag_slot_(k)] += aKs.A + aKs.B;
+        continue;
+      }
+
+      // for the neighbor, A and B of the face are reversed
+      const NTPFA_node& aLs = alpha_osf_[face.twin];
+      double aL = aLs.A * fB + aLs.B * fA;
+
+      double muK = Solver::coeff_mu(aK, aL);
+      double muL = 1.0 - muK;
+
+      double B_sigma = muL * aL - muK * aK;
+      double B_sigma_p = Solver::bsigma_plus(B_sigma);
+      double B_sigma_n = Solver::bsigma_minus(B_sigma);
+
+      double A_K = muK * (aKs.A + aKs.B) + B_sigma_p / (f_(k) + 1e-15);
+      double A_L = muL * (aLs.A + aLs.B) + B_sigma_n / (f_(face.nbr) + 1e-15);
+
+      val[diag_slot_(k)] += A_K;
+      val[slot] -= A_L;
+    }
+
+    double mass = G_(k) / dt;
+    val[diag_slot_(k)] += mass;
+    R_(k) = R + mass * f_(k);
+  }
+}
+
+void Amr_solver::update(double dt) {
+  assemble(dt);
+
+  if (!analyzed_) { // first step after a change of the leaves
+    lsolver_->analyze(M_);
+    analyzed_ = true;
+  }
+  lsolver_->factorize(M_);
+
+  Eigen::VectorXd x = f_; // the previous f is the initial guess
+  lsolver_->solve(R_, &x);
+  f_ = x;
+
+  if (paras.alpha0_min_bct() == 0) {
+    #pragma omp parallel for schedule(static)
+    for (std::size_t k = 0; k < tree_.ncells(); ++k)
+      f_(k) *= exp(-dt/tau_(k));
+  }
+
+  t_ += dt;
+  update_vertex_f();
+}
+
+bool Amr_solver::adapt() {
+  std::size_t n = tree_.ncells();
+  std::vector<int> flags(n);
+
+  double fmax = f_.cwiseAbs().maxCoeff();
+  if (fmax == 0) fmax = 1;
+
+  auto rel = [](double a, double b) { // the jump relative to the mean
+    double s = std::abs(a) + std::abs(b);
+    return s > 0 ? 2 * std::abs(a - b) / s : 0.0;
+  };
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t k = 0; k < n; ++k) {
+    double jf = 0, jd = 0;
+
+    for (int h = tree_.face_begin(k); h < tree_.face_end(k); ++h) {
+      int L = tree_.face(h).nbr;
+      if (L < 0) continue;
+
+      jf = std::max(jf, std::abs(f_(k) - f_(L)) / fmax);
+      jd = std::max(jd, std::max(rel(Daa_(k), Daa_(L)), rel(Dyy_(k), Dyy_(L))));
+    }
+
+    if (jf > paras.amr_refine_tol() || jd > paras.amr_d_tol())
+      flags[k] = 1;
+    else if (jf < paras.amr_coarsen_tol() && jd < paras.amr_d_tol() / 2)
+      flags[k] = -1;
+    else
+      flags[k] = 0;
+  }
+
+  if (!tree_.adapt(flags, &f_)) return false;
+
+  setup();
+  update_vertex_f();
+  return true;
+}
@@ -0,0 +1,89 @@
+/*
+ * File:        Amr_solver.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#ifndef AMR_SOLVER_H_
+#define AMR_SOLVER_H_
+
+#include "common.h"
+#include "Mesh.h"
+#include "D.h"
+#include "BCs.h"
+#include "Parameters.h"
+#include "Linear_solver.h"
+#include "Solver.h"
+#include "Quadtree.h"
+#include <vector>
+#include <memory>
+
+//
+// The PPFV scheme of Solver on the leaves of a Quadtree, with backward
+// Euler steps. The leaves are polygons (their faces are split at hanging
+// nodes), and f at the vertices is interpolated from the leaves around
+// them, weighted by the inverse distance to their centers. D is
+// interpolated to the leaf centers from the D tables (D::at).
+//
+class Amr_solver {
+  public:
+    Amr_solver(const Parameters& paras_in, const Mesh& m_in, const D& d_in, const BCs& bcs_in);
+
+    void update(double dt); // a step of dt
+
+    // Refine the leaves where f or D jump to a neighbor, coarsen where
+    // they are flat, and carry f over. Returns true if the leaves changed.
+    bool adapt();
+
+    double t() const { return t_; }
+    const Quadtree& tree() const { return tree_; }
+    const Eigen::VectorXd& f() const { return f_; }
+
+  private:
+    const Parameters& paras;
+    const Mesh& m;
+    const D& d;
+    const BCs& bcs;
+
+    Quadtree tree_;
+
+    double t_;
+
+    // M f = R, assembled directly into the compressed storage of M_ as in
+    // Solver: slot_[h] is the position of the entry (leaf, neighbor) of
+    // face h, or one of the boundary tags.
+    std::unique_ptr<Linear_solver> lsolver_;
+    SpMat M_;
+    static const int kSlotDirbc = -1;
+    static const int kSlotNone = -2;
+    std::vector<int> slot_;
+    Eigen::VectorXi diag_slot_;
+    bool analyzed_;
+
+    Eigen::VectorXd f_;
+    Eigen::VectorXd R_;
+
+    // per leaf
+    Eigen::VectorXd G_; // G*area
+    Eigen::VectorXd tau_;
+    Eigen::VectorXd Daa_;
+    Eigen::VectorXd Dyy_;
+
+    std::vector<NTPFA_node> alpha_osf_; // per face
+
+    Eigen::VectorXd vertex_f_;
+    std::vector<double> vertex_w_; // the weight of each leaf around a vertex
+
+    void init_f();
+
+    // everything that depends on the leaves
+    void setup();
+
+    void update_vertex_f();
+    void assemble(double dt);
+};
+
+#endif /* AMR_SOLVER_H_ */
@@ -14,9 +14,60 @@
 #include <cstdlib>
 #include <cmath>
 #include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "D.h"
 #include "common.h"
 
+namespace fs = std::filesystem; 
+
+//
+// Binary cache of a D file, <file>.bin: this header followed by the 
+// denormalized values of D_raw in Eigen (column major) order. 
+// The cache is only used if everything in the header matches: the 
+// D grid in the parameter file, the denormalization factor, the size 
+// and modification time of the text file, and the checksum of the values. 
+// It is machine specific (native byte order and layout). 
+//
+struct D_cache_header {
+  char magic[8]; 
+  uint32_t version; 
+  uint32_t byte_order; 
+  int32_t nalpha0_D; 
+  int32_t nE_D; 
+  double alpha0_min_D; 
+  double alpha0_max_D; 
+  double Emin_D; 
+  double Emax_D; 
+  double factor; 
+  uint64_t source_size; 
+  int64_t source_mtime; 
+  uint64_t checksum; 
+}; 
+
+const char gDCacheMagic[9] = "FVM2DDTB"; 
+const uint32_t gDCacheVersion = 1; 
+const uint32_t gDCacheByteOrder = 0x01020304; 
+
+// FNV-1a
+static uint64_t checksum(const void* data, std::size_t n){
+  const unsigned char* p = static_cast<const unsigned char*>(data); 
+  uint64_t h = 14695981039346656037ULL; 
+  for (std::size_t k = 0; k < n; ++k) {
+    h ^= p[k]; 
+    h *= 1099511628211ULL; 
+  }
+  return h; 
+}
+
 D::D(const Parameters& paras_in, const Mesh& mesh_in) : paras(paras_in), m(mesh_in) {
     // Initialize matrices Dap, Dpp, and Daa based on mesh size
     Daa_ = Eigen::MatrixXd::Zero(m.nx(), m.ny());
@@ -26,24 +77,196 @@ D::D(const Parameters& paras_in, const Mesh& mesh_in) : paras(paras_in), m(mesh_
     Day_ = Eigen::MatrixXd::Zero(m.nx(), m.ny());
     Dyy_ = Eigen::MatrixXd::Zero(m.nx(), m.ny());
 
-    constructD(paras, 0.0);
+    version_ = 0; 
+    dirty_.resize((m.nx() + kTile - 1) / kTile, (m.ny() + kTile - 1) / kTile); 
+
+    build_locs(); 
+
+    if (paras.time_dependent_D()) {
+        read_schedule(); 
+
+        i0_ = 0; 
+        i1_ = std::min<std::size_t>(1, schedule_.size() - 1); 
+        get_snapshot(i0_, &snap0_); 
+        get_snapshot(i1_, &snap1_); 
+
+        updateCoefficients(0.0); 
+    }
+    else {
+        constructD(paras, 0.0);
+    }
+}
+
+// one "t dID" line per snapshot, t in days and ascending; # starts a comment
+void D::read_schedule() {
+    std::ifstream fin(paras.D_schedule()); 
+    if (!fin.is_open()) {
+        std::cerr << "Cannot open the D schedule " << paras.D_schedule() << std::endl; 
+        exit(1); 
+    }
+
+    std::string line, dID; 
+    double t; 
+
+    while (std::getline(fin, line)) {
+        line = line.substr(0, line.find('#')); 
+        std::istringstream ist(line); 
+        if (!(ist >> t)) continue; 
+
+        if (!(ist >> dID) || (!schedule_.empty() && t <= schedule_.back().first)) {
+            std::cerr << "Bad line in the D schedule " << paras.D_schedule() << ": " << line << std::endl; 
+            exit(1); 
+        }
+        schedule_.push_back(std::make_pair(t, dID)); 
+    }
+
+    if (schedule_.empty()) {
+        std::cerr << "The D schedule " << paras.D_schedule() << " is empty" << std::endl; 
+        exit(1); 
+    }
+}
+
+void D::start_prefetch(std::size_t k) {
+    iprefetch_ = k; 
+    if (k >= schedule_.size()) return; 
+
+    prefetch_ = std::async(std::launch::async, [this, k]() {
+        D_snapshot snap; 
+        read_snapshot(schedule_[k].second, &snap); 
+        snap.t = schedule_[k].first; 
+        return snap; 
+    }); 
+}
+
+// snapshot k of the schedule; waits for the prefetch if it is that one
+void D::get_snapshot(std::size_t k, D_snapshot* sp) {
+    if (prefetch_.valid() && iprefetch_ == k) {
+        *sp = prefetch_.get(); 
+    }
+    else {
+        if (prefetch_.valid()) prefetch_.wait(); 
+        read_snapshot(schedule_[k].second, sp); 
+        sp->t = schedule_[k].first; 
+    }
+
+    if (k + 1 < schedule_.size() && !(prefetch_.valid() && iprefetch_ == k + 1)) start_prefetch(k + 1); 
+}
+
+double D::next_change(double t) const {
+    for (const auto& entry : schedule_) 
+        if (entry.first > t) return entry.first; 
+
+    return std::numeric_limits<double>::infinity(); 
 }
 
 void D::updateCoefficients(double t) {
-    // Implement according to your logic to update Dap, Dpp, Daa with time t
+    if (!paras.time_dependent_D()) return; 
+
+    while (i1_ > i0_ && t > snap1_.t && i1_ + 1 < schedule_.size()) {
+        snap0_ = std::move(snap1_); 
+        i0_ = i1_; 
+        ++i1_; 
+        get_snapshot(i1_, &snap1_); 
+    }
+
+    double w = 0.0; 
+    if (i1_ > i0_) w = std::min(1.0, std::max(0.0, (t - snap0_.t) / (snap1_.t - snap0_.t))); 
+
+    blend(snap0_, snap1_, w); 
+}
+
+
+// the header that a valid cache of the D file address must have
+void D::d_cache_header(const std::string& address, D_cache_header* hp) const {
+    D_cache_header& h = *hp; 
+    std::memset(&h, 0, sizeof(h)); 
+
+    std::memcpy(h.magic, gDCacheMagic, 8); 
+    h.version = gDCacheVersion; 
+    h.byte_order = gDCacheByteOrder; 
+    h.nalpha0_D = paras.nalpha0_D(); 
+    h.nE_D = paras.nE_D(); 
+    h.alpha0_min_D = paras.alpha0_min_D(); 
+    h.alpha0_max_D = paras.alpha0_max_D(); 
+    h.Emin_D = paras.Emin_D(); 
+    h.Emax_D = paras.Emax_D(); 
+    h.factor = denormalize_factor(); 
+    h.source_size = fs::file_size(address); 
+    h.source_mtime = fs::last_write_time(address).time_since_epoch().count(); 
+}
+
+// true if address.bin is a valid cache; the values are then copied into D_raw
+bool D::read_d_cache(const std::string& address, Eigen::MatrixXd* D_rawp) const {
+    Eigen::MatrixXd& D_raw = *D_rawp; 
+    std::string cache = address + ".bin"; 
+    std::size_t nbytes = sizeof(double) * D_raw.size(); 
+
+    int fd = open(cache.c_str(), O_RDONLY); 
+    if (fd < 0) return false; 
+
+    struct stat st; 
+    if (fstat(fd, &st) != 0 || (std::size_t)st.st_size != sizeof(D_cache_header) + nbytes) {
+        close(fd); 
+        return false; 
+    }
+
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0); 
+    close(fd); 
+    if (map == MAP_FAILED) return false; 
+
+    D_cache_header expected; 
+    d_cache_header(address, &expected); 
+
+    D_cache_header header; 
+    std::memcpy(&header, map, sizeof(header)); 
+    const char* values = static_cast<const char*>(map) + sizeof(D_cache_header); 
+
+    expected.checksum = header.checksum; 
+    bool valid = std::memcmp(&header, &expected, sizeof(header)) == 0 && 
+      checksum(values, nbytes) == header.checksum; 
+
+    if (valid) std::memcpy(D_raw.data(), values, nbytes); 
+
+    munmap(map, st.st_size); 
+    return valid; 
 }
 
+// written to a temporary file first, so that a reader never sees a partial cache
+void D::write_d_cache(const std::string& address, const Eigen::MatrixXd& D_raw) const {
+    std::string cache = address + ".bin"; 
+    std::string tmp = cache + ".tmp" + std::to_string(getpid()) + "_" + 
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())); 
+    std::size_t nbytes = sizeof(double) * D_raw.size(); 
+
+    D_cache_header header; 
+    d_cache_header(address, &header); 
+    header.checksum = checksum(D_raw.data(), nbytes); 
+
+    std::ofstream out(tmp, std::ios::binary); 
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header)); 
+    out.write(reinterpret_cast<const char*>(D_raw.data()), nbytes); 
+    out.close(); 
+
+    std::error_code ec; 
+    if (out) fs::rename(tmp, cache, ec); 
+
+    if (!out || ec) {
+        fs::remove(tmp, ec); 
+        std::cerr << "Cannot write the cache " << cache << "; continuing without it." << std::endl; 
+    }
+}
 
 // read diffusion coefficients from file
-void D::read_d(std::string address, Eigen::MatrixXd* D_rawp){
+void D::read_d(std::string address, Eigen::MatrixXd* D_rawp) const {
     Eigen::MatrixXd& D_raw = *D_rawp; 
 
+    if (paras.use_d_cache() && read_d_cache(address, D_rawp)) return; 
+
     std::ifstream fin(address);
     assert(fin.is_open());
     std::string line;
 
-    const double denormalize_factor = gME * gME * gC * gC;
-    const double second_to_day = 3600 * 24;
+    const double factor = denormalize_factor(); 
 
     int nalpha0, nenergy;
 
@@ -53,12 +276,14 @@ void D::read_d(std::string address, Eigen::MatrixXd* D_rawp){
     for (int i = 0; i < nalpha0; i++){
         for (int j = 0; j < nenergy; j++){
             fin >> D_raw(i, j);
-            D_raw(i, j) *= denormalize_factor * second_to_day;
+            D_raw(i, j) *= factor;
         }
     }
+
+    if (paras.use_d_cache()) write_d_cache(address, D_raw); 
 }
 
-void D::locate(double alpha0, double p, Loc* locp){
+void D::locate(double alpha0, double p, Loc* locp) const {
     int i0, j0;
     double wi, wj;
     double logE = log(p2e(p, gE0)); 
@@ -99,46 +324,138 @@ void D::locate(double alpha0, double p, Loc* locp){
     locp->wj = wj; 
 }
 
-double Dinterp(const Eigen::MatrixXd& Draw, const Loc& loc){
-   int i0,j0;
-   double wi, wj; 
-   i0 = loc.i0;
-   j0 = loc.j0;
-   wi = loc.wi;
-   wj = loc.wj; 
+void D::build_locs(){
+    std::size_t n = m.nx() * m.ny(); 
+    loc_off_.resize(n); 
+    loc_wi_.resize(n); 
+    loc_wj_.resize(n); 
+
+    Loc loc; 
+    std::size_t k; 
+
+    for(std::size_t j = 0; j < m.ny(); j++){
+        for(std::size_t i = 0; i < m.nx(); i++){
+            locate(m.x(i), m.p(j), &loc); 
+
+            k = j * m.nx() + i; 
+            loc_off_(k) = loc.i0 + loc.j0 * paras.nalpha0_D(); 
+            loc_wi_(k) = loc.wi; 
+            loc_wj_(k) = loc.wj; 
+        }
+    }
+}
+
+// Draw at the cells of the mesh: a gather and blend with the precomputed stencils 
+static void Dinterp(const Eigen::MatrixXd& Draw, const Eigen::VectorXi& off, 
+    const Eigen::VectorXd& wi, const Eigen::VectorXd& wj, Eigen::MatrixXd* Dp){
 
-   return Draw(i0,j0)*wi*wj + Draw(i0+1,j0)*(1-wi)*wj + Draw(i0+1,j0+1)*(1-wi)*(1-wj) + Draw(i0,j0+1)*wi*(1-wj);
+   const double* d00 = Draw.data();                    // (i0, j0)
+   const double* d10 = Draw.data() + 1;                // (i0+1, j0)
+   const double* d11 = Draw.data() + 1 + Draw.rows();  // (i0+1, j0+1)
+   const double* d01 = Draw.data() + Draw.rows();      // (i0, j0+1)
+   double* D = Dp->data(); 
+
+   #pragma omp parallel for simd schedule(static)
+   for (long k = 0; k < (long)off.size(); ++k) {
+     int o = off(k); 
+     D[k] = d00[o]*wi(k)*wj(k) + d10[o]*(1-wi(k))*wj(k) + d11[o]*(1-wi(k))*(1-wj(k)) + d01[o]*wi(k)*(1-wj(k));
+   }
 } 
 
 void D::constructD(const Parameters& par, double t){
-    double a, p;
+    read_tables(par.dID(), &tables_); 
 
-    Eigen::MatrixXd Daa_raw(par.nalpha0_D(), par.nE_D());
-    Eigen::MatrixXd Dap_raw(par.nalpha0_D(), par.nE_D());
-    Eigen::MatrixXd Dpp_raw(par.nalpha0_D(), par.nE_D());
+    D_snapshot snap; 
+    snap.dID = par.dID(); 
+    interpolate(tables_, &snap); 
+    snap.t = t; 
 
-    std::string dfile_base = "D/" + par.dID() + "/" + par.dID() + ".";
+    blend(snap, snap, 0.0); 
+}
 
-    read_d(dfile_base + "Daa", &Daa_raw);
-    read_d(dfile_base + "Dap", &Dap_raw);
-    read_d(dfile_base + "Dpp", &Dpp_raw);
+void D::at(double alpha0, double p, double* daap, double* dayp, double* dyyp) const {
+    assert(!paras.time_dependent_D()); 
 
     Loc loc; 
+    locate(alpha0, p, &loc); 
+
+    int i0 = loc.i0, j0 = loc.j0; 
+    double wi = loc.wi, wj = loc.wj; 
+    auto interp = [&](const Eigen::MatrixXd& Draw) {
+      return Draw(i0,j0)*wi*wj + Draw(i0+1,j0)*(1-wi)*wj + Draw(i0+1,j0+1)*(1-wi)*(1-wj) + Draw(i0,j0+1)*wi*(1-wj); 
+    }; 
 
-    for(std::size_t i = 0; i < m.nx(); i++){
-        a = m.x(i);
-        for(std::size_t j = 0; j < m.ny(); j++){
-            p = m.p(j);
-            
-            locate(a, p, &loc);  
-            
-            Daa_(i,j) = Dinterp(Daa_raw, loc) / (p*p); 
-            Dap_(i,j) = Dinterp(Dap_raw, loc) / p; 
-            Dpp_(i,j) = Dinterp(Dpp_raw, loc);
-
-            Day_(i,j) = Dap_(i,j) / p; 
-            Dyy_(i,j) = Dpp_(i,j) / (p*p); 
+    *daap = interp(tables_.Daa) / (p*p); 
+    *dayp = interp(tables_.Dap) / p / p; 
+    *dyyp = interp(tables_.Dpp) / (p*p); 
+}
+
+void D::read_tables(const std::string& dID, D_tables* tp) const {
+    tp->Daa.resize(paras.nalpha0_D(), paras.nE_D());
+    tp->Dap.resize(paras.nalpha0_D(), paras.nE_D());
+    tp->Dpp.resize(paras.nalpha0_D(), paras.nE_D());
+
+    std::string dfile_base = "D/" + dID + "/" + dID + ".";
+
+    read_d(dfile_base + "Daa", &tp->Daa);
+    read_d(dfile_base + "Dap", &tp->Dap);
+    read_d(dfile_base + "Dpp", &tp->Dpp);
+}
+
+void D::read_snapshot(const std::string& dID, D_snapshot* sp) const {
+    D_tables tab; 
+    read_tables(dID, &tab); 
+
+    sp->dID = dID; 
+    interpolate(tab, sp); 
+}
+
+void D::interpolate(const D_tables& tab, D_snapshot* sp) const {
+    D_snapshot& snap = *sp; 
+
+    snap.Daa.resize(m.nx(), m.ny()); 
+    snap.Dap.resize(m.nx(), m.ny()); 
+    snap.Dpp.resize(m.nx(), m.ny()); 
+
+    Dinterp(tab.Daa, loc_off_, loc_wi_, loc_wj_, &snap.Daa); 
+    Dinterp(tab.Dap, loc_off_, loc_wi_, loc_wj_, &snap.Dap); 
+    Dinterp(tab.Dpp, loc_off_, loc_wi_, loc_wj_, &snap.Dpp); 
+
+    const Eigen::VectorXd& p = m.p(); 
+    snap.Daa.array().rowwise() /= (p.array() * p.array()).transpose(); 
+    snap.Dap.array().rowwise() /= p.array().transpose(); 
+}
+
+void D::blend(const D_snapshot& s0, const D_snapshot& s1, double w){
+
+    dirty_.setConstant(false); 
+
+    // One tile column per iteration, so that each dirty flag is written by a single thread. 
+    #pragma omp parallel for schedule(static)
+    for(std::size_t it = 0; it < ntiles_x(); it++){
+        double p; 
+        double daa, dap, dpp; 
+
+        for(std::size_t i = it*kTile; i < std::min((it+1)*kTile, m.nx()); i++){
+            for(std::size_t j = 0; j < m.ny(); j++){
+                p = m.p(j);
+
+                daa = (1 - w) * s0.Daa(i,j) + w * s1.Daa(i,j); 
+                dap = (1 - w) * s0.Dap(i,j) + w * s1.Dap(i,j); 
+                dpp = (1 - w) * s0.Dpp(i,j) + w * s1.Dpp(i,j); 
+
+                if (daa != Daa_(i,j) || dap != Dap_(i,j) || dpp != Dpp_(i,j)) 
+                  dirty_(it, j / kTile) = true; 
+
+                Daa_(i,j) = daa; 
+                Dap_(i,j) = dap; 
+                Dpp_(i,j) = dpp;
+
+                Day_(i,j) = Dap_(i,j) / p; 
+                Dyy_(i,j) = Dpp_(i,j) / (p*p); 
+            }
         }
     }
-}
 
+    if (dirty_.any()) ++version_; 
+}
@@ -14,6 +14,10 @@
 #include "common.h"
 #include "Parameters.h"
 #include "Mesh.h"
+#include <vector>
+#include <future>
+
+struct D_cache_header; 
 
 struct Loc{
   int i0;
@@ -22,6 +26,22 @@ struct Loc{
   double wj; 
 }; 
 
+// the denormalized tables of one dID, on the D grid
+struct D_tables {
+  Eigen::MatrixXd Daa; 
+  Eigen::MatrixXd Dap; 
+  Eigen::MatrixXd Dpp; 
+}; 
+
+// D of one dID, interpolated to the mesh
+struct D_snapshot {
+  double t; 
+  std::string dID; 
+  Eigen::MatrixXd Daa; 
+  Eigen::MatrixXd Dap; 
+  Eigen::MatrixXd Dpp; 
+}; 
+
 class D {
 public:
     D(const Parameters& paras_in, const Mesh& mesh_in);
@@ -36,6 +56,31 @@ public:
 
     void constructD(const Parameters& par, double t);
 
+    // D at any point (alpha0, p), interpolated from the tables like D at the 
+    // cells of the mesh; for meshes other than the one D was built for (see 
+    // Amr_solver). Only for a D that does not depend on time. 
+    void at(double alpha0, double p, double* daap, double* dayp, double* dyyp) const; 
+
+    // Update diffusion coefficients with time. 
+    // For time-dependent D, D at t is interpolated linearly between the 
+    // two snapshots of the schedule that bracket t. Only these two are kept; 
+    // the one after them is read by a background thread in the meantime. 
+    void updateCoefficients(double t);
+
+    // the first time after t at which the time dependence of D has a kink 
+    // (a snapshot time of the schedule); infinity if there is none
+    double next_change(double t) const; 
+
+    // version() is increased each time constructD changes the coefficients. 
+    // The mesh is divided into tiles of kTile x kTile cells, and 
+    // tile_dirty(it, jt) tells whether any coefficient in tile (it, jt) 
+    // changed in the latest version. 
+    static const std::size_t kTile = 16; 
+    std::size_t version() const { return version_; }
+    std::size_t ntiles_x() const { return dirty_.rows(); }
+    std::size_t ntiles_y() const { return dirty_.cols(); }
+    bool tile_dirty(std::size_t it, std::size_t jt) const { return dirty_(it, jt); }
+
 private:
     
     const Parameters& paras; 
@@ -48,10 +93,51 @@ private:
     Eigen::MatrixXd Day_;
     Eigen::MatrixXd Dyy_;
 
-    // Update diffusion coefficients with time
-    void updateCoefficients(double t);
-    void locate(double alpha0, double p, Loc* locp);
-    void read_d(std::string address, Eigen::MatrixXd* D_rawp);
+    std::size_t version_; 
+    Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic> dirty_; 
+
+    // time-dependent D: the schedule (t, dID), and the snapshots i0_ and i1_ of it
+    std::vector<std::pair<double, std::string>> schedule_; 
+    std::size_t i0_; 
+    std::size_t i1_; 
+    D_snapshot snap0_; 
+    D_snapshot snap1_; 
+
+    std::future<D_snapshot> prefetch_; 
+    std::size_t iprefetch_; 
+
+    void read_schedule(); 
+    void get_snapshot(std::size_t k, D_snapshot* sp); 
+    void start_prefetch(std::size_t k); 
+
+    // the tables of a D that does not depend on time
+    D_tables tables_; 
+
+    void read_tables(const std::string& dID, D_tables* tp) const; 
+    void read_snapshot(const std::string& dID, D_snapshot* sp) const; 
+    void interpolate(const D_tables& tab, D_snapshot* sp) const; 
+
+    // set D to (1-w)*s0 + w*s1 and mark the tiles that change
+    void blend(const D_snapshot& s0, const D_snapshot& s1, double w); 
+
+    // The bilinear interpolation stencil of every cell in the D tables, 
+    // computed once for the mesh and the D grid: for cell k = j*nx+i, 
+    // the table entry (i0, j0) is at offset loc_off_(k) = i0 + j0*nalpha0_D, 
+    // with the weights loc_wi_(k) and loc_wj_(k) of that corner. 
+    Eigen::VectorXi loc_off_; 
+    Eigen::VectorXd loc_wi_; 
+    Eigen::VectorXd loc_wj_; 
+
+    void build_locs(); 
+    void locate(double alpha0, double p, Loc* locp) const;
+    void read_d(std::string address, Eigen::MatrixXd* D_rawp) const;
+
+    // D in the files has dimension [p^2]/[s] in units of me*c; we use days
+    static double denormalize_factor() { return gME * gME * gC * gC * (3600 * 24); }
+
+    void d_cache_header(const std::string& address, D_cache_header* hp) const; 
+    bool read_d_cache(const std::string& address, Eigen::MatrixXd* D_rawp) const; 
+    void write_d_cache(const std::string& address, const Eigen::MatrixXd& D_raw) const; 
 };
 
 #endif /* D_H_ */
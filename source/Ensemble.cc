@@ -0,0 +1,136 @@
+/*
+ * File:        Ensemble.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include "Ensemble.h"
+#include "Simulation.h"
+#include "Ini_reader.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+bool Ensemble::is_spec(const string& file){
+  mINI::INIFile fin(file); 
+  mINI::INIStructure ini; 
+  return fin.read(ini) && ini.has("ensemble"); 
+}
+
+Ensemble::Ensemble(const string& spec_file){
+
+  Ini_reader ireader(spec_file); 
+  ireader.set_section("ensemble"); 
+
+  string members; 
+  ireader.read("base", &base_file_); 
+  ireader.read("nworkers", &nworkers_); 
+  ireader.read("members", &members); 
+
+  assert(nworkers_ > 0); 
+
+  std::istringstream ist(members); 
+  string name; 
+  while (ist >> name) names_.push_back(name); 
+
+  for (const auto& nm : names_) setup_member(ireader.ini, nm); 
+}
+
+void Ensemble::setup_member(const mINI::INIStructure& spec, const string& name){
+
+  if (!spec.has(name)) {
+    std::cerr << "Ensemble: no section [" << name << "] for member " << name << std::endl; 
+    exit(1); 
+  }
+
+  Ini_reader ireader(base_file_); 
+  mINI::INIStructure& ini = ireader.ini; 
+
+  ini["basic"]["run_id"] = ini.get("basic").get("run_id") + "_" + name; 
+
+  for (const auto& item : spec.get(name)) { // section.key = value
+    std::size_t dot = item.first.find('.'); 
+    if (dot == string::npos) {
+      std::cerr << "Ensemble: member " << name << ": expected section.key, got " << item.first << std::endl; 
+      exit(1); 
+    }
+    ini[item.first.substr(0, dot)][item.first.substr(dot+1)] = item.second; 
+  }
+
+  Parameters* pp = new Parameters(base_file_, &ireader); 
+  paras_.push_back(std::unique_ptr<Parameters>(pp)); 
+
+  // the parameter file of this member
+  mINI::INIFile fout(pp->output_path() + pp->run_id() + ".ini"); 
+  fout.generate(ini, true); 
+
+  string mkey = mesh_key(*pp); 
+  if (mesh_pool_.count(mkey) == 0) mesh_pool_[mkey].reset(new Mesh(*pp)); 
+  meshes_.push_back(mesh_pool_[mkey].get()); 
+
+  string dkey = mkey + d_key(*pp); 
+  if (pp->time_dependent_D()) dkey += " " + pp->run_id(); // D changes during the run
+  if (d_pool_.count(dkey) == 0) d_pool_[dkey].reset(new D(*pp, *meshes_.back())); 
+  ds_.push_back(d_pool_[dkey].get()); 
+}
+
+// members with equal keys have identical meshes and D
+string Ensemble::mesh_key(const Parameters& paras){
+  std::ostringstream ost; 
+  ost << std::hexfloat << paras.nalpha0() << " " << paras.nE() << " " << paras.alpha0_min() << " " 
+    << paras.alpha0_max() << " " << paras.pmin() << " " << paras.pmax() << " " << paras.dt() << " " 
+    << paras.alpha0_grid() << " " << paras.alpha0_ratio() << " " << paras.alpha0_file() << " " 
+    << paras.E_grid() << " " << paras.E_ratio() << " " << paras.E_file() << " "; 
+  return ost.str(); 
+}
+
+string Ensemble::d_key(const Parameters& paras){
+  std::ostringstream ost; 
+  ost << std::hexfloat << paras.dID() << " " << paras.nalpha0_D() << " " << paras.alpha0_min_D() << " " 
+    << paras.alpha0_max_D() << " " << paras.nE_D() << " " << paras.Emin_D() << " " << paras.Emax_D(); 
+  return ost.str(); 
+}
+
+void Ensemble::run(){
+
+  std::cout << names_.size() << " members, " << mesh_pool_.size() << " meshes, " 
+    << d_pool_.size() << " diffusion coefficients" << std::endl; 
+
+  Eigen::initParallel(); 
+
+  std::atomic<std::size_t> next(0); 
+  std::mutex cout_mutex; 
+
+  auto worker = [&]() {
+    std::size_t k; 
+    while ((k = next++) < names_.size()) {
+      const Parameters& paras = *paras_[k]; 
+
+#ifdef _OPENMP
+      omp_set_num_threads(paras.nthreads()); 
+#endif
+
+      auto start = std::chrono::steady_clock::now(); 
+
+      Simulation simulation(paras, *meshes_[k], *ds_[k]); 
+      simulation.run(); 
+
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start; 
+
+      std::lock_guard<std::mutex> lock(cout_mutex); 
+      std::cout << "member " << names_[k] << " (" << paras.run_id() << ") finished in " 
+        << elapsed.count() << " seconds" << std::endl; 
+    }
+  }; 
+
+  std::vector<std::thread> workers; 
+  for (int w = 0; w < nworkers_; ++w) workers.push_back(std::thread(worker)); 
+  for (auto& t : workers) t.join(); 
+}
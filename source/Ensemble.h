@@ -0,0 +1,70 @@
+/*
+ * File:        Ensemble.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include <vector>
+#include <map>
+#include <memory>
+#include "common.h"
+#include "Parameters.h"
+#include "Mesh.h"
+#include "D.h"
+
+//
+// Runs many variants of a parameter file in one process. 
+//
+// The sweep file looks like 
+//
+//   [ensemble]
+//   base = p.ini
+//   nworkers = 4
+//   members = L4 L5
+//
+//   [L4]
+//   basic.L = 4.0
+//
+// base is the parameter file all members start from, nworkers the number 
+// of members running at the same time, and members the names of the 
+// member sections. In a member section, section.key = value overrides 
+// the base file. 
+// Member output goes to ./output/<run_id>/, where run_id defaults to 
+// <base run_id>_<member name>. Members with the same mesh share one 
+// Mesh, and those that also use the same static diffusion coefficients 
+// share one D. A time-dependent D is never shared. 
+// Workers take the next member from a shared queue as soon as they finish one. 
+//
+class Ensemble {
+  public:
+    Ensemble(const string& spec_file); 
+
+    static bool is_spec(const string& file); 
+
+    void run(); 
+
+  private:
+    string base_file_; 
+    int nworkers_; 
+    std::vector<string> names_; 
+
+    std::vector<std::unique_ptr<Parameters>> paras_; 
+    std::vector<const Mesh*> meshes_; 
+    std::vector<D*> ds_; 
+
+    std::map<string, std::unique_ptr<Mesh>> mesh_pool_; 
+    std::map<string, std::unique_ptr<D>> d_pool_; 
+
+    void setup_member(const mINI::INIStructure& spec, const string& name); 
+
+    static string mesh_key(const Parameters& paras); 
+    static string d_key(const Parameters& paras); 
+}; 
+
+#endif /* ENSEMBLE_H_ */
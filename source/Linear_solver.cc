@@ -0,0 +1,213 @@
+/*
+ * File:        Linear_solver.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#include "Linear_solver.h"
+#include <algorithm>
+
+typedef Eigen::IncompleteLUT<double> Ilut_preconditioner; 
+
+static void configure(Ilu0_preconditioner& pc, const Parameters& paras) {}
+
+static void configure(Mg_preconditioner& pc, const Parameters& paras) {
+  pc.configure(paras); 
+}
+
+static void configure(Ilut_preconditioner& pc, const Parameters& paras) {
+  pc.setDroptol(paras.ilut_droptol()); 
+  pc.setFillfactor(paras.ilut_fill()); 
+}
+
+template<typename Precond>
+static void configure(Eigen::BiCGSTAB<SpMat, Precond>& krylov, const Parameters& paras) {
+  configure(krylov.preconditioner(), paras); 
+}
+
+template<typename Precond>
+static void configure(Eigen::GMRES<SpMat, Precond>& krylov, const Parameters& paras) {
+  krylov.set_restart(paras.gmres_restart()); 
+  configure(krylov.preconditioner(), paras); 
+}
+
+template<typename Krylov>
+static std::unique_ptr<Linear_solver> make_krylov_solver(const Parameters& paras){
+  Krylov_solver<Krylov>* lsp = new Krylov_solver<Krylov>(paras); 
+  configure(lsp->krylov(), paras); 
+  return std::unique_ptr<Linear_solver>(lsp); 
+}
+
+std::unique_ptr<Linear_solver> make_linear_solver(const Parameters& paras){
+
+  const string& type = paras.solver_type(); 
+  const string& pc = paras.preconditioner(); 
+
+  if (type == "lu") return std::unique_ptr<Linear_solver>(new LU_solver); 
+  if (type == "banded") return std::unique_ptr<Linear_solver>(new Banded_solver); 
+  if (type == "mg") return std::unique_ptr<Linear_solver>(new Mg_solver(paras)); 
+
+  if (type != "bicgstab" && type != "gmres") {
+    std::cerr << "Unknown linear solver type: " << type << ". Use lu, banded, mg, bicgstab or gmres." << std::endl; 
+    exit(1); 
+  }
+
+  if (pc != "ilu0" && pc != "ilut" && pc != "mg") {
+    std::cerr << "Unknown preconditioner: " << pc << ". Use ilu0, ilut or mg." << std::endl; 
+    exit(1); 
+  }
+
+  if (type == "bicgstab") {
+    if (pc == "ilu0") return make_krylov_solver<Eigen::BiCGSTAB<SpMat, Ilu0_preconditioner>>(paras); 
+    else if (pc == "ilut") return make_krylov_solver<Eigen::BiCGSTAB<SpMat, Ilut_preconditioner>>(paras); 
+    else return make_krylov_solver<Eigen::BiCGSTAB<SpMat, Mg_preconditioner>>(paras); 
+  }
+  else {
+    if (pc == "ilu0") return make_krylov_solver<Eigen::GMRES<SpMat, Ilu0_preconditioner>>(paras); 
+    else if (pc == "ilut") return make_krylov_solver<Eigen::GMRES<SpMat, Ilut_preconditioner>>(paras); 
+    else return make_krylov_solver<Eigen::GMRES<SpMat, Mg_preconditioner>>(paras); 
+  }
+}
+
+
+void Mg_solver::solve(const Eigen::VectorXd& R, Eigen::VectorXd* xp){
+  double Rnorm = R.norm(); 
+  if (Rnorm == 0.0) Rnorm = 1.0; 
+
+  error_ = (R - (*M_) * (*xp)).norm() / Rnorm; 
+  iterations_ = 0; 
+
+  while (error_ > tol_ && iterations_ < maxit_) {
+    mg.cycle(R, xp); 
+    error_ = (R - (*M_) * (*xp)).norm() / Rnorm; 
+    ++iterations_; 
+  }
+
+  if (error_ > tol_) {
+    std::cerr << "Linear solver did not converge: iterations = " << iterations_ 
+      << ", error = " << error_ << std::endl; 
+  }
+}
+
+
+void Banded_solver::analyze(const SpMat& M){
+  n_ = M.rows(); 
+  kl_ = 0;
+  ku_ = 0; 
+
+  for (int c = 0; c < M.outerSize(); ++c) 
+    for (SpMat::InnerIterator it(M, c); it; ++it) {
+      kl_ = std::max(kl_, (int)it.row() - c); 
+      ku_ = std::max(ku_, c - (int)it.row()); 
+    }
+
+  band_.resize(kl_ + ku_ + 1, n_); 
+}
+
+void Banded_solver::factorize(const SpMat& M){
+  band_.setZero(); 
+
+  for (int c = 0; c < M.outerSize(); ++c) 
+    for (SpMat::InnerIterator it(M, c); it; ++it) at(it.row(), c) = it.value(); 
+
+  int rmax, cmax; 
+  double pivot, ukc; 
+
+  for (int k = 0; k < n_; ++k) {
+    pivot = at(k,k); 
+    if (pivot == 0.0) {
+      std::cerr << "Banded_solver: zero pivot in row " << k << std::endl; 
+      exit(1); 
+    }
+
+    rmax = std::min(n_ - 1, k + kl_); 
+    cmax = std::min(n_ - 1, k + ku_); 
+
+    for (int r = k+1; r <= rmax; ++r) at(r,k) /= pivot; // column k of L
+
+    for (int c = k+1; c <= cmax; ++c) {
+      ukc = at(k,c); 
+      if (ukc == 0.0) continue; 
+
+      double* col = &at(k+1, c); // rows k+1..rmax of column c are contiguous
+      const double* l = &at(k+1, k); 
+      for (int r = 0; r < rmax - k; ++r) col[r] -= l[r] * ukc; 
+    }
+  }
+}
+
+void Banded_solver::solve(const Eigen::VectorXd& R, Eigen::VectorXd* xp){
+  Eigen::VectorXd& x = *xp; 
+  x = R; 
+
+  for (int c = 0; c < n_; ++c) { // L y = R, unit diagonal, column oriented
+    int rmax = std::min(n_ - 1, c + kl_); 
+    for (int r = c+1; r <= rmax; ++r) x(r) -= at(r,c) * x(c); 
+  }
+
+  for (int c = n_ - 1; c >= 0; --c) { // U x = y
+    x(c) /= at(c,c); 
+    int rmin = std::max(0, c - ku_); 
+    for (int r = rmin; r < c; ++r) x(r) -= at(r,c) * x(c); 
+  }
+}
+
+
+void Ilu0_preconditioner::find_diag(){
+  diag_.resize(lu_.rows()); 
+
+  for (int r = 0; r < lu_.rows(); ++r) {
+    diag_[r] = -1; 
+    for (int k = lu_.outerIndexPtr()[r]; k < lu_.outerIndexPtr()[r+1]; ++k) 
+      if (lu_.innerIndexPtr()[k] == r) diag_[r] = k; 
+  }
+}
+
+// the IKJ variant of Gaussian elimination restricted to the pattern of M
+void Ilu0_preconditioner::factorize_inplace(){
+  const int* outer = lu_.outerIndexPtr(); 
+  const int* inner = lu_.innerIndexPtr(); 
+  double* val = lu_.valuePtr(); 
+
+  std::vector<int> pos(lu_.cols(), -1); // column -> position in the current row
+
+  info_ = Eigen::Success; 
+
+  for (int r = 0; r < lu_.rows(); ++r) {
+    for (int k = outer[r]; k < outer[r+1]; ++k) pos[inner[k]] = k; 
+
+    for (int k = outer[r]; k < outer[r+1] && inner[k] < r; ++k) {
+      int c = inner[k]; // eliminate with row c
+      val[k] /= val[diag_[c]]; 
+
+      for (int kc = diag_[c] + 1; kc < outer[c+1]; ++kc) {
+        if (pos[inner[kc]] >= 0) val[pos[inner[kc]]] -= val[k] * val[kc]; 
+      }
+    }
+
+    for (int k = outer[r]; k < outer[r+1]; ++k) pos[inner[k]] = -1; 
+
+    if (diag_[r] < 0 || val[diag_[r]] == 0.0) info_ = Eigen::NumericalIssue; 
+  }
+}
+
+Eigen::VectorXd Ilu0_preconditioner::solve(const Eigen::VectorXd& b) const {
+  const int* outer = lu_.outerIndexPtr(); 
+  const int* inner = lu_.innerIndexPtr(); 
+  const double* val = lu_.valuePtr(); 
+
+  Eigen::VectorXd x = b; 
+
+  for (int r = 0; r < lu_.rows(); ++r) // L y = b, unit diagonal
+    for (int k = outer[r]; k < diag_[r]; ++k) x(r) -= val[k] * x(inner[k]); 
+
+  for (int r = lu_.rows() - 1; r >= 0; --r) { // U x = y
+    for (int k = diag_[r] + 1; k < outer[r+1]; ++k) x(r) -= val[k] * x(inner[k]); 
+    x(r) /= val[diag_[r]]; 
+  }
+
+  return x; 
+}
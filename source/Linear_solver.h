@@ -0,0 +1,217 @@
+/*
+ * File:        Linear_solver.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#ifndef LINEAR_SOLVER_H_
+#define LINEAR_SOLVER_H_
+
+#include <memory>
+#include "common.h"
+#include "Parameters.h"
+#include "Multigrid.h"
+#include "unsupported/Eigen/IterativeSolvers"
+
+//
+// The backends used by Solver to solve M f = R. 
+// 
+// analyze() is called when the sparsity pattern of M changes, 
+// factorize() whenever the values of M change, and solve() takes 
+// the initial guess in *xp (the previous f) and returns the solution in it. 
+//
+class Linear_solver {
+  public:
+    virtual ~Linear_solver() {}
+
+    virtual void analyze(const SpMat& M) = 0; 
+    virtual void factorize(const SpMat& M) = 0; 
+    virtual void solve(const Eigen::VectorXd& R, Eigen::VectorXd* xp) = 0; 
+
+    // statistics of the last solve; direct solvers report 0 iterations
+    virtual int iterations() const { return 0; }
+    virtual double error() const { return 0.0; }
+
+    // the nonzeros of the factors of the direct solvers, 0 for the others
+    virtual long factor_nonzeros() const { return 0; }
+}; 
+
+std::unique_ptr<Linear_solver> make_linear_solver(const Parameters& paras); 
+
+
+// sparse LU with COLAMD ordering
+class LU_solver : public Linear_solver {
+  public:
+    void analyze(const SpMat& M) { solver.analyzePattern(M); }
+    void factorize(const SpMat& M) { solver.factorize(M); }
+    void solve(const Eigen::VectorXd& R, Eigen::VectorXd* xp) { *xp = solver.solve(R); }
+
+    long factor_nonzeros() const { return solver.nnzL() + solver.nnzU(); }
+
+  private:
+    Eigen::SparseLU<SpMat, Eigen::COLAMDOrdering<int>> solver;
+}; 
+
+
+//
+// LU factorization in band storage without pivoting. 
+// With the cell numbering j*nx+i of Mesh::ind2to1, M is block tridiagonal 
+// with a bandwidth of nx, and the fill-in of LU stays inside the band. 
+// M is diagonally dominant for the PPFV discretization, so no pivoting is needed. 
+// The memory is (2*nx+1)*nx*ny doubles and the cost nx*nx*nx*ny, independent 
+// of the values of M; there is no sparse symbolic analysis. 
+//
+class Banded_solver : public Linear_solver {
+  public:
+    void analyze(const SpMat& M); 
+    void factorize(const SpMat& M); 
+    void solve(const Eigen::VectorXd& R, Eigen::VectorXd* xp); 
+
+    long factor_nonzeros() const { return band_.size(); }
+
+  private:
+    int n_;
+    int kl_; // number of sub-diagonals
+    int ku_; // number of super-diagonals
+
+    // band_(ku_ + r - c, c) = M(r, c), LAPACK style
+    Eigen::MatrixXd band_; 
+
+    double& at(int r, int c) { return band_(ku_ + r - c, c); }
+}; 
+
+
+//
+// Incomplete LU factorization with zero fill-in, ILU(0), used as a 
+// preconditioner of the Eigen Krylov solvers. 
+// The factors keep exactly the sparsity pattern of M. 
+//
+class Ilu0_preconditioner {
+  public:
+    Ilu0_preconditioner(): info_(Eigen::Success) {}
+
+    template<typename MatType>
+    Ilu0_preconditioner& analyzePattern(const MatType& mat) { 
+      lu_ = mat; 
+      find_diag(); 
+      return *this; 
+    }
+
+    template<typename MatType>
+    Ilu0_preconditioner& factorize(const MatType& mat) { 
+      lu_ = mat; 
+      if ((long)diag_.size() != lu_.rows()) find_diag(); 
+      factorize_inplace(); 
+      return *this; 
+    }
+
+    template<typename MatType>
+    Ilu0_preconditioner& compute(const MatType& mat) { 
+      analyzePattern(mat); 
+      return factorize(mat); 
+    }
+
+    Eigen::VectorXd solve(const Eigen::VectorXd& b) const; 
+
+    Eigen::ComputationInfo info() const { return info_; }
+
+  private:
+    Eigen::SparseMatrix<double, Eigen::RowMajor> lu_; 
+    std::vector<int> diag_; // position of the diagonal entry of each row in lu_
+    Eigen::ComputationInfo info_; 
+
+    void find_diag(); 
+    void factorize_inplace(); 
+}; 
+
+
+// multigrid cycles until the relative residual is below tol
+class Mg_solver : public Linear_solver {
+  public:
+    Mg_solver(const Parameters& paras): tol_(paras.solver_tol()), maxit_(paras.solver_maxit()), 
+      iterations_(0), error_(0.0) { mg.configure(paras); }
+
+    void analyze(const SpMat& M) { mg.analyze(); }
+    void factorize(const SpMat& M) { mg.setup(M); M_ = &M; }
+    void solve(const Eigen::VectorXd& R, Eigen::VectorXd* xp); 
+
+    int iterations() const { return iterations_; }
+    double error() const { return error_; }
+
+  private:
+    Multigrid mg; 
+    const SpMat* M_; 
+
+    double tol_; 
+    int maxit_; 
+    int iterations_; 
+    double error_; 
+}; 
+
+
+// one multigrid cycle from a zero initial guess, as a preconditioner of the Krylov solvers
+class Mg_preconditioner {
+  public:
+    void configure(const Parameters& paras) { mg.configure(paras); }
+
+    template<typename MatType>
+    Mg_preconditioner& analyzePattern(const MatType& mat) { mg.analyze(); return *this; }
+
+    template<typename MatType>
+    Mg_preconditioner& factorize(const MatType& mat) { 
+      if (mg.nlevels() == 0) mg.analyze(); 
+      mg.setup(SpMat(mat)); 
+      return *this; 
+    }
+
+    template<typename MatType>
+    Mg_preconditioner& compute(const MatType& mat) { analyzePattern(mat); return factorize(mat); }
+
+    Eigen::VectorXd solve(const Eigen::VectorXd& b) const {
+      Eigen::VectorXd x = Eigen::VectorXd::Zero(b.size()); 
+      mg.cycle(b, &x); 
+      return x; 
+    }
+
+    Eigen::ComputationInfo info() const { return Eigen::Success; }
+
+  private:
+    mutable Multigrid mg; 
+}; 
+
+
+// Krylov solvers: BiCGSTAB or GMRES, with ILU(0), ILUT or multigrid preconditioners
+template<typename Krylov>
+class Krylov_solver : public Linear_solver {
+  public:
+    Krylov_solver(const Parameters& paras) {
+      solver.setTolerance(paras.solver_tol()); 
+      solver.setMaxIterations(paras.solver_maxit()); 
+    }
+
+    Krylov& krylov() { return solver; }
+
+    void analyze(const SpMat& M) { solver.analyzePattern(M); }
+    void factorize(const SpMat& M) { solver.factorize(M); }
+
+    void solve(const Eigen::VectorXd& R, Eigen::VectorXd* xp) { 
+      Eigen::VectorXd& x = *xp; 
+      x = solver.solveWithGuess(R, Eigen::VectorXd(x)); 
+
+      if (solver.info() != Eigen::Success) {
+        std::cerr << "Linear solver did not converge: iterations = " << solver.iterations() 
+          << ", error = " << solver.error() << std::endl; 
+      }
+    }
+
+    int iterations() const { return solver.iterations(); }
+    double error() const { return solver.error(); }
+
+  private:
+    Krylov solver; 
+}; 
+
+#endif /* LINEAR_SOLVER_H_ */
@@ -8,69 +8,54 @@
  */
 
 #include "Mesh.h"
+#include <fstream>
+#include <algorithm>
+
+void Mesh::build_edges(const string& grid, double ratio, const string& file, 
+    double lo, double hi, Eigen::VectorXd* edgesp) {
+
+  Eigen::VectorXd& e = *edgesp; 
+  std::size_t n = e.size() - 1; 
+
+  if (grid == "uniform") {
+    double d = (hi - lo) / n; 
+    for (std::size_t k=0; k<=n; ++k) e(k) = lo + k*d; 
+  }
+  else if (grid == "geometric") {
+    // widths w, w*ratio, w*ratio^2, ... adding up to hi - lo
+    double w = std::abs(ratio - 1) < 1e-12 ? (hi - lo) / n : (hi - lo) * (ratio - 1) / (std::pow(ratio, n) - 1); 
+    e(0) = lo; 
+    for (std::size_t k=1; k<n; ++k) {
+      e(k) = e(k-1) + w; 
+      w *= ratio; 
+    }
+    e(n) = hi; 
+  }
+  else { // file: n+1 increasing fractions of the range, from 0 to 1
+    std::ifstream in(file); 
+    if (!in) {
+      std::cerr << "Cannot open the grid file " << file << std::endl; 
+      exit(1); 
+    }
 
+    std::vector<double> s; 
+    double v; 
+    while (in >> v) s.push_back(v); 
 
-void Mesh::build_connectivity() {
-
-      int inbr; 
-
-      Point A; 
-      Point B; 
-
-      for (std::size_t i=0; i<nx(); ++i) {
-        for (std::size_t j=0; j<ny(); ++j) {
-          // nbr 0
-            inbr = 0; 
-            nbr_inds(i,j,inbr).i = i-1;
-            nbr_inds(i,j,inbr).j = j; 
-
-            B(0) = xO_ + i*dx();  
-            B(1) = yO_ + j*dy(); 
-
-            A(0) = B(0); 
-            A(1) = B(1)+dy(); 
-
-            edges(i,j,inbr).A = A;
-            edges(i,j,inbr).B = B;
-
-          // nbr 1
-            inbr = 1;
-            nbr_inds(i,j,inbr).i = i;
-            nbr_inds(i,j,inbr).j = j+1;
-  
-            B = A; 
-            A(0) = B(0) + dx(); 
-            A(1) = B(1); 
-
-            edges(i,j,inbr).A = A;
-            edges(i,j,inbr).B = B; 
-
-          // nbr 2
-            inbr = 2; 
-            nbr_inds(i,j,inbr).i = i+1;
-            nbr_inds(i,j,inbr).j = j;
-
-            B = A; 
-            A(0) = B(0);  
-            A(1) = B(1) - dy();  
-
-            edges(i,j,inbr).A = A;
-            edges(i,j,inbr).B = B; 
-
-          // nbr 3
-            inbr = 3;
-            nbr_inds(i,j,inbr).i = i;
-            nbr_inds(i,j,inbr).j = j-1;
-
-            B = A; 
-            A(0) = B(0) - dx(); 
-            A(1) = B(1); 
-
-            edges(i,j,inbr).A = A;
-            edges(i,j,inbr).B = B; 
-        }
+    if (s.size() != n + 1 || std::abs(s.front()) > 1e-12 || std::abs(s.back() - 1) > 1e-12) {
+      std::cerr << "The grid file " << file << " must list " << n + 1 
+        << " cell edges, from 0 to 1." << std::endl; 
+      exit(1); 
+    }
+    for (std::size_t k=1; k<=n; ++k) {
+      if (s[k] <= s[k-1]) {
+        std::cerr << "The cell edges in " << file << " must be increasing." << std::endl; 
+        exit(1); 
       }
-
     }
 
-
+    for (std::size_t k=1; k<n; ++k) e(k) = lo + s[k] * (hi - lo); 
+    e(0) = lo; 
+    e(n) = hi; 
+  }
+}
@@ -31,7 +31,8 @@ struct Edge{
 
 class Mesh {
   public:
-    Mesh(const Parameters& paras): x_(paras.nalpha0()), y_(paras.nE()), p_(paras.nE()) {
+    Mesh(const Parameters& paras): x_(paras.nalpha0()), y_(paras.nE()), p_(paras.nE()), 
+      xv_(paras.nalpha0()+1), yv_(paras.nE()+1) {
 
         nx_ = paras.nalpha0(); 
         ny_ = paras.nE();
@@ -41,22 +42,16 @@ class Mesh {
         p0_ = paras.pmin(); 
         yO_ = std::log(p0_);
 
-        dx_ = (paras.alpha0_max() - paras.alpha0_min()) / paras.nalpha0(); 
-        dy_ = (std::log(paras.pmax()) - std::log(paras.pmin())) / paras.nE(); 
+        build_edges(paras.alpha0_grid(), paras.alpha0_ratio(), paras.alpha0_file(), 
+            xO_, paras.alpha0_max(), &xv_); 
+        build_edges(paras.E_grid(), paras.E_ratio(), paras.E_file(), 
+            yO_, std::log(paras.pmax()), &yv_); 
 
-        x_(0) = xO() + dx()/2.0; 
-        y_(0) = yO() + dy()/2.0; 
-
-        for (std::size_t i=1; i<nx(); ++i) x_(i) = x_(0) + i*dx(); 
-        for (std::size_t j=1; j<ny(); ++j) y_(j) = y_(0) + j*dy(); 
+        for (std::size_t i=0; i<nx(); ++i) x_(i) = (xv_(i) + xv_(i+1)) / 2.0; 
+        for (std::size_t j=0; j<ny(); ++j) y_(j) = (yv_(j) + yv_(j+1)) / 2.0; 
 
         for (std::size_t j=0; j<ny(); ++j) p_(j) = std::exp(y_(j)); 
 
-        nbr_inds.resize({nx(), ny(), 4});
-        edges.resize({nx(), ny(), 4});
-
-        build_connectivity(); 
-
         // The reverse inbr number.
         // For example, if the current cell is K, its 0th neighbor is L.
         // Then, for cell L, K is its 2th neighbor.
@@ -80,25 +75,23 @@ class Mesh {
 
     double p0() const { return p0_; }
 
+    // cell edges: cell i spans [xv(i), xv(i+1)], cell j spans [yv(j), yv(j+1)]
+    const Eigen::VectorXd& xv() const { return xv_; }
+    const Eigen::VectorXd& yv() const { return yv_; }
+    double xv(int i) const { return xv_(i); }
+    double yv(int j) const { return yv_(j); }
+
     std::size_t nx() const { return nx_; }
     std::size_t ny() const { return ny_; }
-    double dx() const { return dx_; }
-    double dy() const { return dy_; }
+    double dx(int i) const { return xv_(i+1) - xv_(i); }
+    double dy(int j) const { return yv_(j+1) - yv_(j); }
+    double area(int i, int j) const { return dx(i) * dy(j); }
     double dt() const { return dt_; }
-    double area_dt() const { return dx_ * dy_ / dt_;}
 
     int ind2to1(int i, int j) const { // map 2d indices to 1, column major
       return j*nx()+i; 
     }
 
-    void indO(const Point& A, Ind* indp) const { 
-      // calculate the i,j coordinate relative to the Origin
-      // Note: not the cell index.
-      // This function is useful to calculate fA and fB from interpolation
-      indp->i = round((A(0) - xO()) / dx());
-      indp->j = round((A(1) - yO()) / dy()); 
-    }
-
     std::size_t nnbrs() const { return 4; } // each cell has 4 nbrs
                                     
     // define the neighbor # of four adjacent cells
@@ -111,19 +104,38 @@ class Mesh {
 
     int rinbr(int inbr) const { return rinbr_(inbr); }                                    
 
+    // The connectivity and the edges follow from (i,j) and the cell edges 
+    // xv_, yv_, so nothing is stored per cell. 
     void get_nbr_ind(int i, int j, int inbr, Ind* nbr_indp) const {
-      *nbr_indp = nbr_inds(i,j,inbr); 
+      static const int di[4] = {-1, 0, 1, 0}; 
+      static const int dj[4] = {0, 1, 0, -1}; 
+      nbr_indp->i = i + di[inbr]; 
+      nbr_indp->j = j + dj[inbr]; 
+    }
+
+    // The vertices A and B of the inbr edge of cell (i,j), as indices of 
+    // vertex_f; vertex (i,j) is the lower left corner of cell (i,j). Going 
+    // clockwise around the cell, the inbr edge goes from corner inbr to 
+    // corner inbr+1 of (i,j), (i,j+1), (i+1,j+1), (i+1,j). 
+    void get_nbr_vertices(int i, int j, int inbr, Ind* Ap, Ind* Bp) const {
+      static const int di[5] = {0, 0, 1, 1, 0}; 
+      static const int dj[5] = {0, 1, 1, 0, 0}; 
+      Bp->i = i + di[inbr]; 
+      Bp->j = j + dj[inbr]; 
+      Ap->i = i + di[inbr+1]; 
+      Ap->j = j + dj[inbr+1]; 
     }
 
     void get_nbr_edg(int i, int j, int inbr, Edge* edgep) const {
-      *edgep = edges(i,j,inbr); 
+      Ind a, b; 
+      get_nbr_vertices(i, j, inbr, &a, &b); 
+      edgep->A << xv_(a.i), yv_(a.j); 
+      edgep->B << xv_(b.i), yv_(b.j); 
     }
 
   private:
     std::size_t nx_;
     std::size_t ny_;
-    double dx_;
-    double dy_;
     double dt_; 
 
     // coordinate origin: corresponds to i-0.5, j-0.5
@@ -137,13 +149,14 @@ class Mesh {
 
     Eigen::VectorXd p_; 
 
-    Eigen::Vector4i rinbr_; 
-
-    xt::xtensor<Ind,3> nbr_inds;
-    xt::xtensor<Edge,3> edges;
+    Eigen::VectorXd xv_; 
+    Eigen::VectorXd yv_; 
 
+    Eigen::Vector4i rinbr_; 
 
-    void build_connectivity();
+    // the n+1 edges of n cells spanning [lo, hi], for grid = uniform, geometric or file
+    static void build_edges(const string& grid, double ratio, const string& file, 
+        double lo, double hi, Eigen::VectorXd* edgesp); 
 };
 
 #endif /* MESH_H */
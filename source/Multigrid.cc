@@ -0,0 +1,227 @@
+/*
+ * File:        Multigrid.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#include "Multigrid.h"
+#include <algorithm>
+
+void Multigrid::configure(const Parameters& paras){
+  nx_ = paras.nalpha0(); 
+  ny_ = paras.nE(); 
+  W_cycle_ = (paras.mg_cycle() == "W"); 
+  nsmooth_ = paras.mg_nsmooth(); 
+  max_levels_ = paras.mg_levels(); 
+}
+
+void Multigrid::analyze(){
+  assert(nx_ > 0 && ny_ > 0); 
+
+  levels_.clear(); 
+
+  int nx = nx_, ny = ny_; 
+  while (true) {
+    Mg_level L; 
+    L.nx = nx; 
+    L.ny = ny; 
+    levels_.push_back(L); 
+
+    if ((int)levels_.size() >= max_levels_ || nx < 4 || ny < 4) break; 
+    nx = (nx + 1) / 2; 
+    ny = (ny + 1) / 2; 
+  }
+
+  nlevels_ = levels_.size(); 
+
+  for (auto& L : levels_) {
+    int n = L.nx * L.ny; 
+    L.c.resize(n); L.w.resize(n); L.e.resize(n); L.s.resize(n); L.n.resize(n); 
+    L.x.resize(n); L.b.resize(n); L.r.resize(n); 
+  }
+
+  cp_.resize(std::max(nx_, ny_)); 
+  dp_.resize(std::max(nx_, ny_)); 
+
+  coarse_M_.resize(0, 0); 
+}
+
+void Multigrid::setup(const SpMat& M){
+  Mg_level& F = levels_[0]; 
+  int nx = F.nx; 
+  assert(M.rows() == nx * F.ny); 
+
+  F.c.setZero(); F.w.setZero(); F.e.setZero(); F.s.setZero(); F.n.setZero(); 
+
+  for (int col = 0; col < M.outerSize(); ++col) 
+    for (SpMat::InnerIterator it(M, col); it; ++it) {
+      int k = it.row(); 
+      if (col == k) F.c(k) = it.value(); 
+      else if (col == k - 1) F.w(k) = it.value(); 
+      else if (col == k + 1) F.e(k) = it.value(); 
+      else if (col == k - nx) F.s(k) = it.value(); 
+      else if (col == k + nx) F.n(k) = it.value(); 
+      else {
+        std::cerr << "Multigrid: M is not a 5-point stencil on the mesh" << std::endl; 
+        exit(1); 
+      }
+    }
+
+  for (int l = 1; l < nlevels_; ++l) coarsen(levels_[l-1], &levels_[l]); 
+
+  build_coarse_matrix(); 
+}
+
+// Galerkin coarsening with 2x2 agglomeration
+void Multigrid::coarsen(const Mg_level& F, Mg_level* Cp){
+  Mg_level& C = *Cp; 
+
+  C.c.setZero(); C.w.setZero(); C.e.setZero(); C.s.setZero(); C.n.setZero(); 
+
+  int K; 
+  for (int j = 0; j < F.ny; ++j) 
+    for (int i = 0; i < F.nx; ++i) {
+      int k = j * F.nx + i; 
+      K = (j/2) * C.nx + i/2; 
+
+      C.c(K) += F.c(k); 
+
+      if (i % 2 == 1) C.c(K) += F.w(k); else C.w(K) += F.w(k); 
+      if (i % 2 == 0 && i + 1 < F.nx) C.c(K) += F.e(k); else C.e(K) += F.e(k); 
+      if (j % 2 == 1) C.c(K) += F.s(k); else C.s(K) += F.s(k); 
+      if (j % 2 == 0 && j + 1 < F.ny) C.c(K) += F.n(k); else C.n(K) += F.n(k); 
+    }
+}
+
+void Multigrid::build_coarse_matrix(){
+  const Mg_level& L = levels_.back(); 
+  int nx = L.nx; 
+  int n = L.nx * L.ny; 
+
+  std::vector<T> coeffs; 
+  coeffs.reserve(5*n); 
+
+  for (int k = 0; k < n; ++k) {
+    int i = k % nx; 
+    int j = k / nx; 
+    coeffs.push_back(T(k, k, L.c(k))); 
+    if (i > 0) coeffs.push_back(T(k, k-1, L.w(k))); 
+    if (i < nx-1) coeffs.push_back(T(k, k+1, L.e(k))); 
+    if (j > 0) coeffs.push_back(T(k, k-nx, L.s(k))); 
+    if (j < L.ny-1) coeffs.push_back(T(k, k+nx, L.n(k))); 
+  }
+
+  bool first = (coarse_M_.rows() != n); 
+  coarse_M_.resize(n, n); 
+  coarse_M_.setFromTriplets(coeffs.begin(), coeffs.end()); 
+
+  if (first) coarse_lu_.analyzePattern(coarse_M_); 
+  coarse_lu_.factorize(coarse_M_); 
+}
+
+void Multigrid::cycle(const Eigen::VectorXd& b, Eigen::VectorXd* xp){
+  Mg_level& F = levels_[0]; 
+  F.b = b; 
+  F.x = *xp; 
+  cycle(0); 
+  *xp = F.x; 
+}
+
+void Multigrid::cycle(int l){
+  Mg_level& L = levels_[l]; 
+
+  if (l == nlevels_ - 1) {
+    L.x = coarse_lu_.solve(L.b); 
+    return; 
+  }
+
+  for (int k = 0; k < nsmooth_; ++k) smooth(L, true); 
+
+  residual(L); 
+
+  Mg_level& C = levels_[l+1]; 
+  C.b.setZero(); 
+  C.x.setZero(); 
+  for (int j = 0; j < L.ny; ++j) 
+    for (int i = 0; i < L.nx; ++i) C.b((j/2) * C.nx + i/2) += L.r(j * L.nx + i); 
+
+  int ncycles = (W_cycle_ && l + 2 < nlevels_) ? 2 : 1; 
+  for (int k = 0; k < ncycles; ++k) cycle(l+1); 
+
+  for (int j = 0; j < L.ny; ++j) 
+    for (int i = 0; i < L.nx; ++i) L.x(j * L.nx + i) += C.x((j/2) * C.nx + i/2); 
+
+  for (int k = 0; k < nsmooth_; ++k) smooth(L, false); 
+}
+
+// alternating line Gauss-Seidel; the backward sweep reverses the order
+void Multigrid::smooth(Mg_level& L, bool forward){
+  if (forward) {
+    for (int j = 0; j < L.ny; ++j) xline(L, j); 
+    for (int i = 0; i < L.nx; ++i) yline(L, i); 
+  }
+  else {
+    for (int i = L.nx - 1; i >= 0; --i) yline(L, i); 
+    for (int j = L.ny - 1; j >= 0; --j) xline(L, j); 
+  }
+}
+
+// solve the tridiagonal system along the alpha0 line j with the Thomas algorithm
+void Multigrid::xline(Mg_level& L, int j){
+  int nx = L.nx; 
+  int k0 = j * nx; 
+  double rhs, den; 
+
+  for (int i = 0; i < nx; ++i) {
+    int k = k0 + i; 
+    rhs = L.b(k); 
+    if (j > 0) rhs -= L.s(k) * L.x(k - nx); 
+    if (j < L.ny - 1) rhs -= L.n(k) * L.x(k + nx); 
+
+    den = L.c(k) - (i > 0 ? L.w(k) * cp_(i-1) : 0.0); 
+    cp_(i) = L.e(k) / den; 
+    dp_(i) = (rhs - (i > 0 ? L.w(k) * dp_(i-1) : 0.0)) / den; 
+  }
+
+  L.x(k0 + nx - 1) = dp_(nx - 1); 
+  for (int i = nx - 2; i >= 0; --i) L.x(k0 + i) = dp_(i) - cp_(i) * L.x(k0 + i + 1); 
+}
+
+// the same along the log(p) line i
+void Multigrid::yline(Mg_level& L, int i){
+  int nx = L.nx; 
+  int ny = L.ny; 
+  double rhs, den; 
+
+  for (int j = 0; j < ny; ++j) {
+    int k = j * nx + i; 
+    rhs = L.b(k); 
+    if (i > 0) rhs -= L.w(k) * L.x(k - 1); 
+    if (i < nx - 1) rhs -= L.e(k) * L.x(k + 1); 
+
+    den = L.c(k) - (j > 0 ? L.s(k) * cp_(j-1) : 0.0); 
+    cp_(j) = L.n(k) / den; 
+    dp_(j) = (rhs - (j > 0 ? L.s(k) * dp_(j-1) : 0.0)) / den; 
+  }
+
+  L.x((ny - 1) * nx + i) = dp_(ny - 1); 
+  for (int j = ny - 2; j >= 0; --j) L.x(j * nx + i) = dp_(j) - cp_(j) * L.x((j + 1) * nx + i); 
+}
+
+void Multigrid::residual(Mg_level& L){
+  int nx = L.nx; 
+
+  for (int j = 0; j < L.ny; ++j) 
+    for (int i = 0; i < nx; ++i) {
+      int k = j * nx + i; 
+      double Ax = L.c(k) * L.x(k); 
+      if (i > 0) Ax += L.w(k) * L.x(k - 1); 
+      if (i < nx - 1) Ax += L.e(k) * L.x(k + 1); 
+      if (j > 0) Ax += L.s(k) * L.x(k - nx); 
+      if (j < L.ny - 1) Ax += L.n(k) * L.x(k + nx); 
+      L.r(k) = L.b(k) - Ax; 
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * File:        Multigrid.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#ifndef MULTIGRID_H_
+#define MULTIGRID_H_
+
+#include <vector>
+#include "common.h"
+#include "Parameters.h"
+
+//
+// Geometric multigrid for the 5-point system M f = R on the nx x ny Mesh. 
+//
+// Coarse levels agglomerate 2x2 cells; the coarse operators are the 
+// Galerkin products P^T M P with piecewise constant P, so every level 
+// keeps a 5-point stencil. The smoother is alternating line Gauss-Seidel 
+// (alpha0 lines, then log(p) lines), which handles the anisotropy of 
+// Daa and Dyy. The coarsest level is solved with sparse LU. 
+//
+// analyze() builds the hierarchy once; setup() only recomputes the 
+// coefficients, so the hierarchy is reused across time steps. 
+//
+struct Mg_level {
+  int nx; 
+  int ny; 
+
+  // coefficients of cell k = j*nx+i to (i,j), (i-1,j), (i+1,j), (i,j-1), (i,j+1)
+  Eigen::VectorXd c, w, e, s, n; 
+
+  Eigen::VectorXd x, b, r; // work vectors
+}; 
+
+class Multigrid {
+  public:
+    Multigrid(): nlevels_(0), nx_(0), ny_(0), W_cycle_(true), nsmooth_(1), max_levels_(20) {}
+
+    void configure(const Parameters& paras); 
+
+    void analyze(); 
+    void setup(const SpMat& M); 
+
+    // one cycle for M x = b, with the initial guess in *xp
+    void cycle(const Eigen::VectorXd& b, Eigen::VectorXd* xp); 
+
+    int nlevels() const { return nlevels_; }
+
+  private:
+    int nlevels_; 
+    int nx_; 
+    int ny_; 
+    bool W_cycle_; 
+    int nsmooth_; 
+    int max_levels_; 
+
+    std::vector<Mg_level> levels_; 
+
+    SpMat coarse_M_; 
+    Eigen::SparseLU<SpMat, Eigen::COLAMDOrdering<int>> coarse_lu_; 
+
+    Eigen::VectorXd cp_; // Thomas algorithm work arrays
+    Eigen::VectorXd dp_; 
+
+    void cycle(int l); 
+    void smooth(Mg_level& L, bool forward); 
+    void xline(Mg_level& L, int j); 
+    void yline(Mg_level& L, int i); 
+    void residual(Mg_level& L); 
+    void coarsen(const Mg_level& F, Mg_level* Cp); 
+    void build_coarse_matrix(); 
+}; 
+
+#endif /* MULTIGRID_H_ */
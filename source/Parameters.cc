@@ -8,10 +8,11 @@ namespace fs = std::filesystem;
 Parameters::Parameters(int argc, char** argv){
 
   handle_main_input(argc, argv);
-  read_inp_file(); 
 
-  output_path_ = "./output/" + run_id() + "/"; 
-  fs::create_directories(output_path_); 
+  Ini_reader ireader(inp_file()); 
+  read_inp_file(&ireader); 
+
+  create_output_path(); 
 
  // copy the parameter file 
   string paras_file = "./output/" + run_id() + "/" + run_id() + ".ini";
@@ -19,6 +20,16 @@ Parameters::Parameters(int argc, char** argv){
   system(command.c_str());
 }
 
+Parameters::Parameters(const string& inp_file, Ini_reader* ireaderp): inp_file_(inp_file) {
+  read_inp_file(ireaderp); 
+  create_output_path(); 
+}
+
+void Parameters::create_output_path(){
+  output_path_ = "./output/" + run_id() + "/"; 
+  fs::create_directories(output_path_); 
+}
+
 void Parameters::handle_main_input(int argc, char* argv[]){
   switch (argc) {
   case 1:
@@ -35,9 +46,9 @@ void Parameters::handle_main_input(int argc, char* argv[]){
   }
 }
 
-void Parameters::read_inp_file(){
+void Parameters::read_inp_file(Ini_reader* ireaderp){
 
-  Ini_reader ireader(inp_file()); 
+  Ini_reader& ireader = *ireaderp; 
 
   ireader.set_section("basic");
 
@@ -68,12 +79,42 @@ void Parameters::read_inp_file(){
   ireader.read("T", &T_);
   ireader.read("nsteps", &nsteps_);
 
+  ireader.set_section("mesh"); 
+
+  ireader.read("alpha0_grid", &alpha0_grid_); 
+  ireader.read("alpha0_ratio", &alpha0_ratio_); 
+  ireader.read("alpha0_file", &alpha0_file_); 
+  ireader.read("E_grid", &E_grid_); 
+  ireader.read("E_ratio", &E_ratio_); 
+  ireader.read("E_file", &E_file_); 
+  ireader.read("unstructured", &unstructured_); 
+  ireader.read("mesh_file", &mesh_file_); 
+
+  for (const string& grid : {alpha0_grid_, E_grid_}) {
+    if (grid != "uniform" && grid != "geometric" && grid != "file") {
+      std::cerr << "Unknown grid: " << grid << ". Use uniform, geometric or file." << std::endl; 
+      exit(1); 
+    }
+  }
+  assert(alpha0_ratio_ > 0 && E_ratio_ > 0); 
+
   ireader.set_section("diagnostics");
 
   ireader.read("nplots", &nplots_); 
   save_every_step_ = nsteps_ / nplots_; 
   nsteps_ = save_every_step_ * nplots_; 
 
+  ireader.read("output_format", &output_format_); 
+  if (output_format_ != "ascii" && output_format_ != "binary") {
+    std::cerr << "Unknown output_format: " << output_format_ << ". Use ascii or binary." << std::endl; 
+    exit(1); 
+  }
+
+  ireader.read("async_output", &async_output_); 
+  ireader.read("output_buffers", &output_buffers_); 
+  ireader.read("profile", &profile_); 
+  ireader.read("trace", &trace_); 
+
   ireader.set_section("diffusion_coefficients"); 
 
   ireader.read("dID", &dID_);
@@ -91,4 +132,74 @@ void Parameters::read_inp_file(){
 
   dlogE_D_ = (log(Emax_D_) - log(Emin_D_)) / (nE_D_ - 1); 
 
+  ireader.read("use_cache", &use_d_cache_); 
+  ireader.read("time_dependent", &time_dependent_D_); 
+  ireader.read("schedule", &D_schedule_); 
+
+  ireader.set_section("time_stepping"); 
+
+  ireader.read("scheme", &time_scheme_); 
+  if (time_scheme_ != "euler" && time_scheme_ != "bdf2") {
+    std::cerr << "Unknown time stepping scheme: " << time_scheme_ << ". Use euler or bdf2." << std::endl; 
+    exit(1); 
+  }
+
+  ireader.read("adaptive", &adaptive_dt_); 
+  ireader.read("rtol", &dt_rtol_); 
+  ireader.read("atol", &dt_atol_); 
+  ireader.read("dt_min", &dt_min_); 
+  ireader.read("dt_max", &dt_max_); 
+
+  ireader.set_section("nonlinear"); 
+
+  ireader.read("iterate", &nonlinear_iterate_); 
+  ireader.read("tol", &nonlinear_tol_); 
+  ireader.read("maxit", &nonlinear_maxit_); 
+  ireader.read("anderson_depth", &anderson_depth_); 
+  assert(nonlinear_maxit_ > 0 && anderson_depth_ >= 0); 
+
+  ireader.set_section("parallel"); 
+
+  ireader.read("nthreads", &nthreads_); 
+  assert(nthreads_ > 0); 
+
+  ireader.set_section("solver"); 
+
+  ireader.read("type", &solver_type_); 
+  ireader.read("preconditioner", &preconditioner_); 
+  ireader.read("tol", &solver_tol_); 
+  ireader.read("maxit", &solver_maxit_); 
+  ireader.read("ilut_droptol", &ilut_droptol_); 
+  ireader.read("ilut_fill", &ilut_fill_); 
+  ireader.read("gmres_restart", &gmres_restart_); 
+  ireader.read("mg_cycle", &mg_cycle_); 
+  ireader.read("mg_nsmooth", &mg_nsmooth_); 
+  ireader.read("mg_levels", &mg_levels_); 
+
+  ireader.set_section("amr"); 
+
+  ireader.read("enabled", &amr_); 
+  ireader.read("max_level", &amr_max_level_); 
+  ireader.read("refine_tol", &amr_refine_tol_); 
+  ireader.read("coarsen_tol", &amr_coarsen_tol_); 
+  ireader.read("d_tol", &amr_d_tol_); 
+  ireader.read("interval", &amr_interval_); 
+  assert(amr_max_level_ >= 0 && amr_interval_ > 0); 
+
+  if (amr_ && (time_scheme_ != "euler" || adaptive_dt_ || nonlinear_iterate_ || time_dependent_D_ || 
+        solver_type_ == "banded" || solver_type_ == "mg" || 
+        ((solver_type_ == "bicgstab" || solver_type_ == "gmres") && preconditioner_ == "mg"))) {
+    std::cerr << "AMR works with scheme = euler, adaptive = 0, iterate = 0, time_dependent = 0, " 
+      << "and the lu, bicgstab or gmres solvers with ilu0 or ilut." << std::endl; 
+    exit(1); 
+  }
+
+  if (unstructured_ && (amr_ || time_scheme_ != "euler" || adaptive_dt_ || nonlinear_iterate_ || time_dependent_D_ || 
+        solver_type_ == "banded" || solver_type_ == "mg" || 
+        ((solver_type_ == "bicgstab" || solver_type_ == "gmres") && preconditioner_ == "mg"))) {
+    std::cerr << "The unstructured mesh works with enabled = 0 in [amr], scheme = euler, adaptive = 0, " 
+      << "iterate = 0, time_dependent = 0, and the lu, bicgstab or gmres solvers with ilu0 or ilut." << std::endl; 
+    exit(1); 
+  }
+
 }
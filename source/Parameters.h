@@ -5,11 +5,16 @@
 #include <cmath>
 #include "utils.h"
 #include "common.h"
+#include "Ini_reader.h"
 
 class Parameters{
 public:
   Parameters(int argc, char** argv); 
 
+  // read from an already loaded (and possibly modified) parameter file; 
+  // the file itself is not copied to the output path
+  Parameters(const string& inp_file, Ini_reader* ireaderp); 
+
   // ------- READ FROM INP FILE -------
   const string& run_id() const { return run_id_; }
   const string& inp_file() const { return inp_file_; }
@@ -30,11 +35,37 @@ public:
   int nsteps() const { return nsteps_; }
   double dt() const { return T_ / nsteps_;}
 
+  const string& time_scheme() const { return time_scheme_; }
+  int adaptive_dt() const { return adaptive_dt_; }
+  double dt_rtol() const { return dt_rtol_; }
+  double dt_atol() const { return dt_atol_; }
+  double dt_min() const { return dt_min_; }
+  double dt_max() const { return dt_max_; }
+
+  int nonlinear_iterate() const { return nonlinear_iterate_; }
+  double nonlinear_tol() const { return nonlinear_tol_; }
+  int nonlinear_maxit() const { return nonlinear_maxit_; }
+  int anderson_depth() const { return anderson_depth_; }
+
+  const string& alpha0_grid() const { return alpha0_grid_; }
+  double alpha0_ratio() const { return alpha0_ratio_; }
+  const string& alpha0_file() const { return alpha0_file_; }
+  const string& E_grid() const { return E_grid_; }
+  double E_ratio() const { return E_ratio_; }
+  const string& E_file() const { return E_file_; }
+  int unstructured() const { return unstructured_; }
+  const string& mesh_file() const { return mesh_file_; }
+
   double pmin() const { return pmin_; }
   double pmax() const { return pmax_; }
 
   int nplots() const { return nplots_; }
   int save_every_step() const { return save_every_step_; }
+  const string& output_format() const { return output_format_; }
+  int async_output() const { return async_output_; }
+  int output_buffers() const { return output_buffers_; }
+  int profile() const { return profile_; }
+  int trace() const { return trace_; }
   const string& output_path() const { return output_path_; }
 
   const string& dID() const { return dID_; }
@@ -47,6 +78,29 @@ public:
   double Emin_D() const { return Emin_D_; }
   double Emax_D() const { return Emax_D_; }
   double dlogE_D() const { return dlogE_D_; }
+  int use_d_cache() const { return use_d_cache_; }
+  int time_dependent_D() const { return time_dependent_D_; }
+  const string& D_schedule() const { return D_schedule_; }
+
+  int nthreads() const { return nthreads_; }
+
+  const string& solver_type() const { return solver_type_; }
+  const string& preconditioner() const { return preconditioner_; }
+  double solver_tol() const { return solver_tol_; }
+  int solver_maxit() const { return solver_maxit_; }
+  double ilut_droptol() const { return ilut_droptol_; }
+  int ilut_fill() const { return ilut_fill_; }
+  int gmres_restart() const { return gmres_restart_; }
+  const string& mg_cycle() const { return mg_cycle_; }
+  int mg_nsmooth() const { return mg_nsmooth_; }
+  int mg_levels() const { return mg_levels_; }
+
+  int amr() const { return amr_; }
+  int amr_max_level() const { return amr_max_level_; }
+  double amr_refine_tol() const { return amr_refine_tol_; }
+  double amr_coarsen_tol() const { return amr_coarsen_tol_; }
+  double amr_d_tol() const { return amr_d_tol_; }
+  int amr_interval() const { return amr_interval_; }
 
 private:
   string inp_file_; 
@@ -64,6 +118,15 @@ private:
   double Emin_;
   double Emax_; 
 
+  string alpha0_grid_; 
+  double alpha0_ratio_; 
+  string alpha0_file_; 
+  string E_grid_; 
+  double E_ratio_; 
+  string E_file_; 
+  int unstructured_; 
+  string mesh_file_; 
+
   double pmin_;
   double pmax_; 
 
@@ -71,8 +134,25 @@ private:
   double nsteps_;
   double dt_; 
 
+  string time_scheme_; 
+  int adaptive_dt_; 
+  double dt_rtol_; 
+  double dt_atol_; 
+  double dt_min_; 
+  double dt_max_; 
+
+  int nonlinear_iterate_; 
+  double nonlinear_tol_; 
+  int nonlinear_maxit_; 
+  int anderson_depth_; 
+
   int nplots_;
   int save_every_step_; 
+  string output_format_; 
+  int async_output_; 
+  int output_buffers_; 
+  int profile_; 
+  int trace_; 
   string output_path_; 
 
   string dID_;
@@ -86,9 +166,33 @@ private:
   double Emin_D_;
   double Emax_D_;
   double dlogE_D_;  
+  int use_d_cache_; 
+  int time_dependent_D_; 
+  string D_schedule_; 
+
+  int nthreads_; 
+
+  string solver_type_; 
+  string preconditioner_; 
+  double solver_tol_; 
+  int solver_maxit_; 
+  double ilut_droptol_; 
+  int ilut_fill_; 
+  int gmres_restart_; 
+  string mg_cycle_; 
+  int mg_nsmooth_; 
+  int mg_levels_; 
+
+  int amr_; 
+  int amr_max_level_; 
+  double amr_refine_tol_; 
+  double amr_coarsen_tol_; 
+  double amr_d_tol_; 
+  int amr_interval_; 
 
   void handle_main_input(int argc, char* argv[]);
-  void read_inp_file(); 
+  void read_inp_file(Ini_reader* ireaderp); 
+  void create_output_path(); 
 };
 
 #endif /* PARAMETERS_H_ */
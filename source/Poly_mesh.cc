@@ -0,0 +1,216 @@
+/*
+ * File:        Poly_mesh.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include "Poly_mesh.h"
+
+namespace {
+
+// the sides of the domain, numbered like the neighbors of Mesh
+const int kSideIm = 0;
+const int kSideJp = 1;
+const int kSideIp = 2;
+const int kSideJm = 3;
+
+void mesh_error(const string& filename, const string& msg) {
+  std::cerr << "Mesh file " << filename << ": " << msg << std::endl;
+  exit(1);
+}
+
+}
+
+Poly_mesh::Poly_mesh(const Parameters& paras, const string& filename) {
+  std::vector<int> cell_begin, cell_vertices;
+
+  read(filename, &cell_begin, &cell_vertices);
+
+  // from the fractions of the ranges to (alpha0, log(p)); the vertices on
+  // the boundary are put exactly on it
+  double x0 = paras.alpha0_min(), x1 = paras.alpha0_max();
+  double y0 = std::log(paras.pmin()), y1 = std::log(paras.pmax());
+  const double eps = 1e-9;
+
+  vertex_sides_.assign(vertices_.size(), 0);
+  for (std::size_t v = 0; v < vertices_.size(); ++v) {
+    Point& P = vertices_[v];
+    int& sides = vertex_sides_[v];
+
+    if (P(0) < -eps || P(0) > 1 + eps || P(1) < -eps || P(1) > 1 + eps)
+      mesh_error(filename, "vertex " + std::to_string(v) + " is outside of [0, 1] x [0, 1]");
+
+    if (std::abs(P(0)) <= eps)     { P(0) = 0; sides |= 1 << kSideIm; }
+    if (std::abs(P(0) - 1) <= eps) { P(0) = 1; sides |= 1 << kSideIp; }
+    if (std::abs(P(1)) <= eps)     { P(1) = 0; sides |= 1 << kSideJm; }
+    if (std::abs(P(1) - 1) <= eps) { P(1) = 1; sides |= 1 << kSideJp; }
+
+    P(0) = x0 + P(0) * (x1 - x0);
+    P(1) = y0 + P(1) * (y1 - y0);
+  }
+
+  build(filename, cell_begin, cell_vertices);
+}
+
+void Poly_mesh::read(const string& filename, std::vector<int>* cell_beginp, std::vector<int>* cell_verticesp) {
+  std::ifstream in(filename);
+  if (!in) {
+    std::cerr << "Cannot open the mesh file " << filename << std::endl;
+    exit(1);
+  }
+
+  // everything but the comment lines
+  std::stringstream ss;
+  string line;
+  while (std::getline(in, line)) {
+    std::size_t c = line.find_first_not_of(" \t");
+    if (c != string::npos && line[c] != '#') ss << line << "\n";
+  }
+
+  long nv = 0, nc = 0;
+  if (!(ss >> nv >> nc) || nv < 3 || nc < 1)
+    mesh_error(filename, "expected the numbers of vertices and cells");
+
+  vertices_.resize(nv);
+  for (long v = 0; v < nv; ++v) {
+    if (!(ss >> vertices_[v](0) >> vertices_[v](1)))
+      mesh_error(filename, "expected " + std::to_string(nv) + " vertices");
+  }
+
+  std::vector<int>& begin = *cell_beginp;
+  std::vector<int>& cv = *cell_verticesp;
+  begin.assign(1, 0);
+  cv.clear();
+
+  for (long k = 0; k < nc; ++k) {
+    int n;
+    if (!(ss >> n) || n < 3)
+      mesh_error(filename, "expected " + std::to_string(nc) + " cells of at least 3 vertices");
+
+    for (int i = 0; i < n; ++i) {
+      int v;
+      if (!(ss >> v) || v < 0 || v >= nv)
+        mesh_error(filename, "bad vertex index in cell " + std::to_string(k));
+      cv.push_back(v);
+    }
+    begin.push_back(cv.size());
+  }
+}
+
+void Poly_mesh::build(const string& filename, const std::vector<int>& cell_begin, const std::vector<int>& cell_vertices) {
+  std::size_t nc = cell_begin.size() - 1;
+  std::vector<int> cv = cell_vertices;
+
+  centers_.resize(nc);
+  areas_.resize(nc);
+
+  // orient the cells clockwise, and find their areas and centroids
+  for (std::size_t k = 0; k < nc; ++k) {
+    int* b = &cv[cell_begin[k]];
+    int n = cell_begin[k+1] - cell_begin[k];
+
+    double a2 = 0; // twice the signed area, > 0 counterclockwise
+    Point c(0, 0);
+    for (int i = 0; i < n; ++i) {
+      const Point& P = vertices_[b[i]];
+      const Point& Q = vertices_[b[(i+1) % n]];
+      double cross = P(0) * Q(1) - Q(0) * P(1);
+      a2 += cross;
+      c += cross * (P + Q);
+    }
+
+    if (a2 == 0) mesh_error(filename, "cell " + std::to_string(k) + " has no area");
+    if (a2 > 0) std::reverse(b, b + n);
+
+    areas_[k] = std::abs(a2) / 2;
+    centers_[k] = c / (3 * a2);
+
+    // convex: every corner turns clockwise
+    for (int i = 0; i < n; ++i) {
+      Point u = vertices_[b[(i+1) % n]] - vertices_[b[i]];
+      Point w = vertices_[b[(i+2) % n]] - vertices_[b[(i+1) % n]];
+      if (u(0) * w(1) - u(1) * w(0) > 1e-14 * u.norm() * w.norm())
+        mesh_error(filename, "cell " + std::to_string(k) + " is not convex");
+    }
+  }
+
+  // the faces, each once: going clockwise around a cell from B to A, the
+  // neighbor sees the same face from A to B
+  std::unordered_map<uint64_t, int> face_of;
+  face_of.reserve(cv.size());
+
+  cell_face_begin_.assign(1, 0);
+  cell_faces_.clear();
+  face_cells_.clear();
+  face_vertices_.clear();
+
+  for (std::size_t k = 0; k < nc; ++k) {
+    int n = cell_begin[k+1] - cell_begin[k];
+    const int* b = &cv[cell_begin[k]];
+
+    for (int i = 0; i < n; ++i) {
+      int vB = b[i], vA = b[(i+1) % n];
+      uint64_t key = ((uint64_t)std::min(vA, vB) << 32) | (uint64_t)std::max(vA, vB);
+
+      auto it = face_of.find(key);
+      int f;
+      if (it == face_of.end()) {
+        f = face_cells_.size() / 2;
+        face_of[key] = f;
+        face_cells_.push_back(k);
+        face_cells_.push_back(-1);
+        face_vertices_.push_back(vA);
+        face_vertices_.push_back(vB);
+      }
+      else {
+        f = it->second;
+        if (face_cells_[2*f+1] >= 0 || face_vertices_[2*f] != vB)
+          mesh_error(filename, "the face between vertices " + std::to_string(vA) + " and "
+              + std::to_string(vB) + " belongs to more than two cells, or to overlapping ones");
+        face_cells_[2*f+1] = k;
+      }
+      cell_faces_.push_back(f);
+    }
+    cell_face_begin_.push_back(cell_faces_.size());
+  }
+
+  // the boundary faces have to lie on a side of the domain
+  face_sides_.assign(nfaces(), -1);
+  for (std::size_t f = 0; f < nfaces(); ++f) {
+    if (face_cells_[2*f+1] >= 0) continue;
+
+    int common = vertex_sides_[face_vertices_[2*f]] & vertex_sides_[face_vertices_[2*f+1]];
+    for (int s : {kSideIm, kSideJp, kSideIp, kSideJm})
+      if (common & (1 << s)) face_sides_[f] = s;
+
+    if (face_sides_[f] < 0)
+      mesh_error(filename, "the face between vertices " + std::to_string(face_vertices_[2*f]) + " and "
+          + std::to_string(face_vertices_[2*f+1]) + " has one cell but is not on the boundary");
+  }
+
+  // vertex -> cells
+  std::size_t nv = vertices_.size();
+  vertex_begin_.assign(nv + 1, 0);
+  for (int v : cv) ++vertex_begin_[v+1];
+  for (std::size_t v = 0; v < nv; ++v) vertex_begin_[v+1] += vertex_begin_[v];
+
+  vertex_cells_.resize(cv.size());
+  std::vector<int> pos(vertex_begin_.begin(), vertex_begin_.end() - 1);
+  for (std::size_t k = 0; k < nc; ++k)
+    for (int n = cell_begin[k]; n < cell_begin[k+1]; ++n)
+      vertex_cells_[pos[cv[n]]++] = k;
+
+  for (std::size_t v = 0; v < nv; ++v) {
+    if (vertex_begin_[v] == vertex_begin_[v+1])
+      mesh_error(filename, "vertex " + std::to_string(v) + " is not used by any cell");
+  }
+}
@@ -0,0 +1,88 @@
+/*
+ * File:        Poly_mesh.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#ifndef POLY_MESH_H_
+#define POLY_MESH_H_
+
+#include "common.h"
+#include "Mesh.h"
+#include "Parameters.h"
+#include <vector>
+
+//
+// An unstructured mesh of polygons covering the (alpha0, log(p)) domain,
+// read from a text file:
+//
+//   # comment lines start with #
+//   nvertices ncells
+//   x y              -- nvertices lines
+//   n v_1 ... v_n    -- ncells lines, the n vertices of a cell, from 0
+//
+// x and y are the fractions of the alpha0 and log(p) ranges, as in the
+// grid files of Mesh: 0 at alpha0_min (pmin), 1 at alpha0_max (pmax).
+// The cells must be convex and may be listed in either orientation. Two
+// cells share a face if they share its two end points, so a vertex in
+// the middle of a face of a neighbor must be listed in both cells.
+//
+// The connectivity is kept in compressed (CSR) arrays:
+//   cell -> faces:    cell_face(n),   cell_face_begin(k) <= n < cell_face_end(k)
+//   face -> cells:    face_cell(f, 0), face_cell(f, 1) (-1 on the boundary)
+//   face -> vertices: face_vertex(f, 0) = A, face_vertex(f, 1) = B
+//   vertex -> cells:  vertex_cell(n), vertex_begin(v) <= n < vertex_end(v)
+// A face goes from B to A clockwise around face_cell(f, 0), like the edges
+// of Mesh, and counterclockwise around face_cell(f, 1).
+//
+class Poly_mesh {
+  public:
+    Poly_mesh(const Parameters& paras, const string& filename);
+
+    std::size_t ncells() const { return centers_.size(); }
+    const Point& center(int k) const { return centers_[k]; } // the centroid
+    double area(int k) const { return areas_[k]; }
+
+    std::size_t nfaces() const { return face_cells_.size() / 2; }
+    int cell_face_begin(int k) const { return cell_face_begin_[k]; }
+    int cell_face_end(int k) const { return cell_face_begin_[k+1]; }
+    int cell_face(int n) const { return cell_faces_[n]; }
+
+    int face_cell(int f, int s) const { return face_cells_[2*f+s]; }
+    int face_vertex(int f, int s) const { return face_vertices_[2*f+s]; }
+    // the side of the domain (inbr of Mesh) a boundary face is on, -1 inside
+    int face_side(int f) const { return face_sides_[f]; }
+
+    std::size_t nvertices() const { return vertices_.size(); }
+    const Point& vertex(int v) const { return vertices_[v]; }
+    int vertex_begin(int v) const { return vertex_begin_[v]; }
+    int vertex_end(int v) const { return vertex_begin_[v+1]; }
+    int vertex_cell(int n) const { return vertex_cells_[n]; }
+    // bit s is set if vertex v lies on the side s of the domain
+    int vertex_sides(int v) const { return vertex_sides_[v]; }
+
+  private:
+    std::vector<Point> centers_;
+    std::vector<double> areas_;
+
+    std::vector<int> cell_face_begin_;
+    std::vector<int> cell_faces_;
+    std::vector<int> face_cells_;
+    std::vector<int> face_vertices_;
+    std::vector<int> face_sides_;
+
+    std::vector<Point> vertices_;
+    std::vector<int> vertex_begin_;
+    std::vector<int> vertex_cells_;
+    std::vector<int> vertex_sides_;
+
+    // the cells as lists of vertices, clockwise
+    void read(const string& filename, std::vector<int>* cell_beginp, std::vector<int>* cell_verticesp);
+
+    void build(const string& filename, const std::vector<int>& cell_begin, const std::vector<int>& cell_vertices);
+};
+
+#endif /* POLY_MESH_H_ */
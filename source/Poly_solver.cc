@@ -0,0 +1,251 @@
+/*
+ * File:        Poly_solver.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#include <cassert>
+#include <limits>
+#include "Poly_solver.h"
+
+Poly_solver::Poly_solver(const Parameters& paras_in, const Mesh& m_in, const Poly_mesh& pm_in,
+    const D& d_in, const BCs& bcs_in)
+  : paras(paras_in), m(m_in), pm(pm_in), d(d_in), bcs(bcs_in), t_(0) {
+
+  lsolver_ = make_linear_solver(paras);
+
+  init();
+
+  for (std::size_t k = 0; k < pm.ncells(); ++k)
+    f_(k) = bcs.init_f(pm.center(k)(0), std::exp(pm.center(k)(1)));
+
+  update_vertex_f();
+}
+
+void Poly_solver::init() {
+  std::size_t n = pm.ncells();
+  std::size_t nf = pm.nfaces();
+
+  f_.resize(n);
+  R_.resize(n);
+  G_.resize(n);
+  tau_.resize(n);
+  alpha_osf_.resize(2 * nf);
+  face_coeffs_.resize(nf);
+  vertex_f_.resize(pm.nvertices());
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t k = 0; k < n; ++k) {
+    const Point& K = pm.center(k);
+    double a0 = K(0);
+    double p = std::exp(K(1));
+    double daa, day, dyy;
+
+    d.at(a0, p, &daa, &day, &dyy);
+
+    Eigen::Matrix2d Lambda_K;
+    Lambda_K << daa * Solver::G(a0, p), day * Solver::G(a0, p),
+             day * Solver::G(a0, p), dyy * Solver::G(a0, p);
+
+    // the faces go from B to A clockwise around face_cell(f, 0), so they
+    // are reversed for face_cell(f, 1)
+    for (int nn = pm.cell_face_begin(k); nn < pm.cell_face_end(k); ++nn) {
+      int f = pm.cell_face(nn);
+      int s = pm.face_cell(f, 0) == (int)k ? 0 : 1;
+      const Point& A = pm.vertex(pm.face_vertex(f, s));
+      const Point& B = pm.vertex(pm.face_vertex(f, 1 - s));
+      Solver::alpha_osf_func(Lambda_K, K, A, B, &alpha_osf_[2*f+s]);
+    }
+
+    G_(k) = Solver::G(a0, p) * pm.area(k);
+
+    if (a0 < paras.alpha0_lc())
+      tau_(k) = Solver::bounce_period(paras.L(), a0, p) / 4.0;
+    else
+      tau_(k) = std::numeric_limits<double>::max();
+  }
+
+  // the boundary conditions of the faces, as in Solver::build_pattern
+  face_bc_.resize(nf);
+  for (std::size_t f = 0; f < nf; ++f) {
+    int side = pm.face_side(f);
+
+    if (side < 0)
+      face_bc_[f] = 0;
+    else if (side == m.inbr_ip()) // nothing special for alpha=90
+      face_bc_[f] = kSlotNone;
+    else if (side == m.inbr_im() && paras.alpha0_min_bct() == 0) // df/da0 = 0 at alpha0 = 0
+      face_bc_[f] = kSlotNone;
+    else
+      face_bc_[f] = kSlotDirbc;
+  }
+
+  // inverse distance weights of the cells around each vertex
+  vertex_w_.resize(pm.vertex_end(pm.nvertices() - 1));
+  for (std::size_t v = 0; v < pm.nvertices(); ++v) {
+    double sum = 0;
+    for (int nn = pm.vertex_begin(v); nn < pm.vertex_end(v); ++nn) {
+      vertex_w_[nn] = 1.0 / (pm.vertex(v) - pm.center(pm.vertex_cell(nn))).norm();
+      sum += vertex_w_[nn];
+    }
+    for (int nn = pm.vertex_begin(v); nn < pm.vertex_end(v); ++nn) vertex_w_[nn] /= sum;
+  }
+
+  // the sparsity pattern
+  std::vector<T> coeffs;
+  coeffs.reserve(n + 2 * nf);
+  for (std::size_t k = 0; k < n; ++k) coeffs.push_back(T(k, k, 0.0));
+  for (std::size_t f = 0; f < nf; ++f) {
+    if (face_bc_[f] != 0) continue;
+    coeffs.push_back(T(pm.face_cell(f, 0), pm.face_cell(f, 1), 0.0));
+    coeffs.push_back(T(pm.face_cell(f, 1), pm.face_cell(f, 0), 0.0));
+  }
+
+  M_.resize(n, n);
+  M_.setFromTriplets(coeffs.begin(), coeffs.end());
+  M_.makeCompressed();
+
+  const double* val = M_.valuePtr();
+  diag_slot_.resize(n);
+  slot_.resize(pm.cell_face_end(n - 1));
+
+  for (std::size_t k = 0; k < n; ++k) {
+    diag_slot_(k) = &M_.coeffRef(k, k) - val;
+
+    for (int nn = pm.cell_face_begin(k); nn < pm.cell_face_end(k); ++nn) {
+      int f = pm.cell_face(nn);
+      if (face_bc_[f] != 0) {
+        slot_[nn] = face_bc_[f];
+      }
+      else {
+        int L = pm.face_cell(f, 0) == (int)k ? pm.face_cell(f, 1) : pm.face_cell(f, 0);
+        slot_[nn] = &M_.coeffRef(k, L) - val;
+      }
+    }
+  }
+
+  analyzed_ = false;
+}
+
+// The boundary conditions at the vertices are those of Solver::update_vertex_f:
+// f is given at pmin and pmax, and at alpha0_min if alpha0_min_bct != 0.
+void Poly_solver::update_vertex_f() {
+  const int kIm = 1 << m.inbr_im(), kJp = 1 << m.inbr_jp(), kJm = 1 << m.inbr_jm();
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t v = 0; v < pm.nvertices(); ++v) {
+    int sides = pm.vertex_sides(v);
+    const Point& P = pm.vertex(v);
+
+    if (sides & kJm) {
+      vertex_f_(v) = bcs.pmin(t_, P(0));
+    }
+    else if (sides & kJp) {
+      vertex_f_(v) = bcs.pmax(t_, P(0));
+    }
+    else if ((sides & kIm) && paras.alpha0_min_bct() != 0) {
+      vertex_f_(v) = bcs.alpha0_lc(t_, std::exp(P(1)));
+    }
+    else {
+      double fv = 0;
+      for (int nn = pm.vertex_begin(v); nn < pm.vertex_end(v); ++nn)
+        fv += vertex_w_[nn] * f_(pm.vertex_cell(nn));
+      vertex_f_(v) = fv;
+    }
+  }
+}
+
+void Poly_solver::assemble(double dt) {
+  // the fluxes of each face, for both of its cells
+  #pragma omp parallel for schedule(static)
+  for (std::size_t f = 0; f < pm.nfaces(); ++f) {
+    Face_coeffs& c = face_coeffs_[f];
+    if (face_bc_[f] == kSlotNone) continue;
+
+    int K = pm.face_cell(f, 0);
+    double fA = vertex_f_(pm.face_vertex(f, 0));
+    double fB = vertex_f_(pm.face_vertex(f, 1));
+    const NTPFA_node& aKs = alpha_osf_[2*f];
+    double aK = aKs.A * fA + aKs.B * fB;
+
+    if (face_bc_[f] == kSlotDirbc) {
+      c.A_K = aKs.A + aKs.B;
+      c.r = aK;
+      continue;
+    }
+
+    int L = pm.face_cell(f, 1);
+    const NTPFA_node& aLs = alpha_osf_[2*f+1];
+    double aL = aLs.A * fB + aLs.B * fA;
+
+    double muK = Solver::coeff_mu(aK, aL);
+    double muL = 1.0 - muK;
+
+    double B_sigma = muL * aL - muK * aK;
+    double B_sigma_p = Solver::bsigma_plus(B_sigma);
+    double B_sigma_n = Solver::bsigma_minus(B_sigma);
+
+    c.A_K = muK * (aKs.A + aKs.B) + B_sigma_p / (f_(K) + 1e-15);
+    c.A_L = muL * (aLs.A + aLs.B) + B_sigma_n / (f_(L) + 1e-15);
+  }
+
+  // Each cell only writes to its own row of M and R. Seen from L, the
+  // roles of A_K and A_L of a face are swapped.
+  double* val = M_.valuePtr();
+  std::fill(val, val + M_.nonZeros(), 0.0);
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t k = 0; k < pm.ncells(); ++k) {
+    double diag = G_(k) / dt;
+    double R = diag * f_(k);
+
+    for (int nn = pm.cell_face_begin(k); nn < pm.cell_face_end(k); ++nn) {
+      int slot = slot_[nn];
+      if (slot == kSlotNone) continue;
+
+      const Face_coeffs& c = face_coeffs_[pm.cell_face(nn)];
+
+      if (slot == kSlotDirbc) {
+        diag += c.A_K;
+        R += c.r;
+      }
+      else if (pm.face_cell(pm.cell_face(nn), 0) == (int)k) {
+        diag += c.A_K;
+        val[slot] -= c.A_L;
+      }
+      else {
+        diag += c.A_L;
+        val[slot] -= c.A_K;
+      }
+    }
+
+    val[diag_slot_(k)] += diag;
+    R_(k) = R;
+  }
+}
+
+void Poly_solver::update(double dt) {
+  assemble(dt);
+
+  if (!analyzed_) {
+    lsolver_->analyze(M_);
+    analyzed_ = true;
+  }
+  lsolver_->factorize(M_);
+
+  Eigen::VectorXd x = f_; // the previous f is the initial guess
+  lsolver_->solve(R_, &x);
+  f_ = x;
+
+  if (paras.alpha0_min_bct() == 0) {
+    #pragma omp parallel for schedule(static)
+    for (std::size_t k = 0; k < pm.ncells(); ++k)
+      f_(k) *= exp(-dt/tau_(k));
+  }
+
+  t_ += dt;
+  update_vertex_f();
+}
@@ -0,0 +1,95 @@
+/*
+ * File:        Poly_solver.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#ifndef POLY_SOLVER_H_
+#define POLY_SOLVER_H_
+
+#include "common.h"
+#include "Mesh.h"
+#include "D.h"
+#include "BCs.h"
+#include "Parameters.h"
+#include "Linear_solver.h"
+#include "Solver.h"
+#include "Poly_mesh.h"
+#include <vector>
+#include <memory>
+
+//
+// The PPFV scheme of Solver on a Poly_mesh, with backward Euler steps.
+// f at the vertices is interpolated from the cells around them, weighted
+// by the inverse distance to their centroids, and D is interpolated to the
+// centroids from the D tables (D::at).
+//
+// M is assembled by faces: the fluxes of each face are evaluated once,
+// for both of its cells, and then gathered into the rows of the cells.
+//
+class Poly_solver {
+  public:
+    // m_in is only used for the numbering of the sides of the domain
+    Poly_solver(const Parameters& paras_in, const Mesh& m_in, const Poly_mesh& pm_in,
+        const D& d_in, const BCs& bcs_in);
+
+    void update(double dt); // a step of dt
+
+    double t() const { return t_; }
+    const Poly_mesh& mesh() const { return pm; }
+    const Eigen::VectorXd& f() const { return f_; }
+
+  private:
+    const Parameters& paras;
+    const Mesh& m;
+    const Poly_mesh& pm;
+    const D& d;
+    const BCs& bcs;
+
+    double t_;
+
+    // M f = R, assembled directly into the compressed storage of M_ as in
+    // Solver: slot_[n] is the position of the entry (cell, neighbor) of the
+    // face cell_face(n), or one of the boundary tags.
+    std::unique_ptr<Linear_solver> lsolver_;
+    SpMat M_;
+    static const int kSlotDirbc = -1;
+    static const int kSlotNone = -2;
+    std::vector<int> slot_;
+    Eigen::VectorXi diag_slot_;
+    bool analyzed_;
+
+    Eigen::VectorXd f_;
+    Eigen::VectorXd R_;
+
+    // per cell
+    Eigen::VectorXd G_; // G*area
+    Eigen::VectorXd tau_;
+
+    // alpha_osf_[2*f+s] is the one sided flux of face f in cell face_cell(f, s)
+    std::vector<NTPFA_node> alpha_osf_;
+
+    // The coefficients of face f from the last assembly. An inner face
+    // adds A_K to M(K,K) and -A_K to M(L,K), A_L to M(L,L) and -A_L to
+    // M(K,L). A Dirichlet face adds A_K to M(K,K) and r to R(K).
+    struct Face_coeffs {
+      double A_K;
+      double A_L;
+      double r;
+    };
+    std::vector<Face_coeffs> face_coeffs_;
+    std::vector<int> face_bc_; // 0 for inner faces, kSlotDirbc or kSlotNone on the boundary
+
+    Eigen::VectorXd vertex_f_;
+    std::vector<double> vertex_w_; // the weight of each cell around a vertex
+
+    void init();
+
+    void update_vertex_f();
+    void assemble(double dt);
+};
+
+#endif /* POLY_SOLVER_H_ */
@@ -0,0 +1,92 @@
+/*
+ * File:        Profiler.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#include <cassert>
+#include "Profiler.h"
+
+const char* Profiler::name(Phase phase) {
+  static const char* names[kNphases] = {
+    "D", "alpha_osf", "vertex_f", "assemble", "analyze", "factorize", "solve", "nonlinear", "output"
+  };
+  return names[phase];
+}
+
+Profiler::Profiler(const Parameters& paras_in)
+  : paras(paras_in), trace_(paras_in.trace()) {
+
+  log_.open(paras.output_path() + "/" + paras.run_id() + "_profile.csv");
+  assert(log_);
+
+  log_ << "step,t,dt,wall";
+  for (int p = 0; p < kNphases; ++p) log_ << "," << name((Phase)p);
+  log_ << ",solves,nnz,factor_nnz,residual" << std::endl;
+  log_ << std::setprecision(6);
+
+  start_ = Clock::now();
+  step_start_ = start_;
+  reset_step();
+}
+
+void Profiler::reset_step() {
+  std::fill(phase_seconds_, phase_seconds_ + kNphases, 0.0);
+  nsolves_ = 0;
+  nnz_ = 0;
+  factor_nnz_ = 0;
+  residual_ = 0.0;
+}
+
+void Profiler::add(Phase phase, Clock::time_point t0, Clock::time_point t1) {
+  phase_seconds_[phase] += std::chrono::duration<double>(t1 - t0).count();
+  if (trace_) events_.push_back({phase, us(t0), us(t1) - us(t0)});
+}
+
+void Profiler::add_solve(long nnz, long factor_nnz, double residual) {
+  ++nsolves_;
+  nnz_ = nnz;
+  factor_nnz_ = factor_nnz;
+  residual_ = residual;
+}
+
+void Profiler::end_step(long step, double t, double dt) {
+  Clock::time_point now = Clock::now();
+
+  log_ << step << "," << t << "," << dt << "," << std::chrono::duration<double>(now - step_start_).count();
+  for (int p = 0; p < kNphases; ++p) log_ << "," << phase_seconds_[p];
+  log_ << "," << nsolves_ << "," << nnz_ << "," << factor_nnz_ << "," << residual_ << "\n";
+
+  if (trace_) steps_.push_back({step, us(step_start_), us(now) - us(step_start_)});
+
+  step_start_ = now;
+  reset_step();
+}
+
+// The steps are on thread 1 and their phases on thread 2, so that both
+// show up as nested bars.
+void Profiler::finish() {
+  log_.flush();
+  if (!trace_) return;
+
+  ofstream out(paras.output_path() + "/" + paras.run_id() + "_trace.json");
+  assert(out);
+
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"steps\"}},\n";
+  out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"phases\"}}";
+
+  for (const Step_event& s : steps_)
+    out << ",\n{\"name\": \"step " << s.step << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": "
+      << s.ts << ", \"dur\": " << s.dur << "}";
+
+  for (const Event& e : events_)
+    out << ",\n{\"name\": \"" << name(e.phase) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 2, \"ts\": "
+      << e.ts << ", \"dur\": " << e.dur << "}";
+
+  out << "\n]}\n";
+}
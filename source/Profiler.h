@@ -0,0 +1,106 @@
+/*
+ * File:        Profiler.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <vector>
+#include "common.h"
+#include "Parameters.h"
+
+//
+// The wall clock profile of a run, with profile = 1 in [diagnostics].
+//
+// The phases of a step are timed by Scoped_timer on the monotonic
+// steady_clock and summed per step. Each step is one line of
+// <run_id>_profile.csv:
+//   step, t, dt, wall -- the step and its total wall time in seconds
+//   D ... output      -- the seconds spent in each phase of the step
+//   solves            -- the number of linear solves
+//   nnz, factor_nnz   -- the nonzeros of M and of its LU factors
+//                        (0 for the iterative solvers)
+//   residual          -- |R - M f|/|R| of the last solve
+// The phases do not overlap, so they add up to at most the wall time.
+// With trace = 1, every timed interval is also written to
+// <run_id>_trace.json as a Chrome trace event, to be viewed in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Scoped_timer does nothing with a null Profiler, so when profiling is off
+// a timer costs one test of a pointer.
+//
+class Profiler {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum Phase { kD, kAlphaOsf, kVertexF, kAssemble, kAnalyze, kFactorize, kSolve, kNonlinear, kOutput, kNphases };
+    static const char* name(Phase phase);
+
+    Profiler(const Parameters& paras_in);
+
+    void add(Phase phase, Clock::time_point t0, Clock::time_point t1);
+
+    // the linear system of a solve
+    void add_solve(long nnz, long factor_nnz, double residual);
+
+    // write the line of a step that ends now and start the next one
+    void end_step(long step, double t, double dt);
+
+    // write the trace, if enabled
+    void finish();
+
+  private:
+    const Parameters& paras;
+    ofstream log_;
+
+    Clock::time_point start_;      // of the run
+    Clock::time_point step_start_;
+
+    double phase_seconds_[kNphases];
+    int nsolves_;
+    long nnz_;
+    long factor_nnz_;
+    double residual_;
+
+    struct Event {
+      Phase phase;
+      double ts;  // microseconds since start_
+      double dur;
+    };
+    struct Step_event {
+      long step;
+      double ts;
+      double dur;
+    };
+    bool trace_;
+    std::vector<Event> events_;
+    std::vector<Step_event> steps_;
+
+    double us(Clock::time_point t) const {
+      return std::chrono::duration<double, std::micro>(t - start_).count();
+    }
+    void reset_step();
+};
+
+class Scoped_timer {
+  public:
+    Scoped_timer(Profiler* p, Profiler::Phase phase): p_(p), phase_(phase) {
+      if (p_) t0_ = Profiler::Clock::now();
+    }
+    ~Scoped_timer() {
+      if (p_) p_->add(phase_, t0_, Profiler::Clock::now());
+    }
+
+  private:
+    Profiler* p_;
+    Profiler::Phase phase_;
+    Profiler::Clock::time_point t0_;
+};
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,331 @@
+/*
+ * File:        Quadtree.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#include <cassert>
+#include <algorithm>
+#include "Quadtree.h"
+
+// the neighbor across each side, in the order of Mesh::inbr
+static const int kDi[4] = {-1, 0, 1, 0};
+static const int kDj[4] = {0, 1, 0, -1};
+
+static const uint64_t kMask29 = (uint64_t(1) << 29) - 1;
+
+static void decode(uint64_t k, int* levelp, int* Ip, int* Jp) {
+  *levelp = k >> 58;
+  *Ip = (k >> 29) & kMask29;
+  *Jp = k & kMask29;
+}
+
+Quadtree::Quadtree(const Mesh& m_in, int max_level): m(m_in), max_level_(max_level) {
+  assert(max_level >= 0 && (m.nx() << max_level) < (std::size_t(1) << 29) && (m.ny() << max_level) < (std::size_t(1) << 29));
+
+  Leaf_set S;
+  for (std::size_t i=0; i<m.nx(); ++i)
+    for (std::size_t j=0; j<m.ny(); ++j)
+      S.insert(key(0, i, j));
+
+  build(S);
+}
+
+double Quadtree::x_at(int I) const {
+  int bi = I >> max_level_;
+  int sub = I - (bi << max_level_);
+  if (sub == 0) return m.xv(bi);
+  return m.xv(bi) + sub * m.dx(bi) / (1 << max_level_);
+}
+
+double Quadtree::y_at(int J) const {
+  int bj = J >> max_level_;
+  int sub = J - (bj << max_level_);
+  if (sub == 0) return m.yv(bj);
+  return m.yv(bj) + sub * m.dy(bj) / (1 << max_level_);
+}
+
+void Quadtree::bounds(int k, double* x0p, double* x1p, double* y0p, double* y1p) const {
+  const Cell& c = cells_[k];
+  int s = max_level_ - c.level;
+
+  *x0p = x_at(c.I << s);
+  *x1p = x_at((c.I + 1) << s);
+  *y0p = y_at(c.J << s);
+  *y1p = y_at((c.J + 1) << s);
+}
+
+int Quadtree::containing(const Leaf_set& S, int level, int I, int J) {
+  for (int l = level; l >= 0; --l) {
+    if (S.count(key(l, I >> (level - l), J >> (level - l)))) return l;
+  }
+  return -1;
+}
+
+// Before cell (level, I, J) is split, the leaves next to it are refined
+// down to at least its level, so that its children stay balanced.
+void Quadtree::refine(Leaf_set* Sp, int level, int I, int J) const {
+  Leaf_set& S = *Sp;
+  int In, Jn, lc;
+
+  for (int side = 0; side < 4; ++side) {
+    In = I + kDi[side];
+    Jn = J + kDj[side];
+    if (In < 0 || In >= nI(level) || Jn < 0 || Jn >= nJ(level)) continue;
+
+    while ((lc = containing(S, level, In, Jn)) >= 0 && lc < level)
+      refine(Sp, lc, In >> (level - lc), Jn >> (level - lc));
+  }
+
+  S.erase(key(level, I, J));
+  for (int a = 0; a < 2; ++a)
+    for (int b = 0; b < 2; ++b)
+      S.insert(key(level + 1, 2*I + a, 2*J + b));
+}
+
+// the children of cell (level, I, J) can be merged if no leaf next to it
+// is finer than the children
+bool Quadtree::can_coarsen(const Leaf_set& S, int level, int I, int J) const {
+  int In, Jn, ci, cj;
+
+  for (int side = 0; side < 4; ++side) {
+    In = I + kDi[side];
+    Jn = J + kDj[side];
+    if (In < 0 || In >= nI(level) || Jn < 0 || Jn >= nJ(level)) continue;
+
+    for (int n = 0; n < 2; ++n) { // the two cells of level+1 of the neighbor along the face
+      ci = kDi[side] != 0 ? 2*In + (kDi[side] < 0 ? 1 : 0) : 2*In + n;
+      cj = kDj[side] != 0 ? 2*Jn + (kDj[side] < 0 ? 1 : 0) : 2*Jn + n;
+      if (containing(S, level + 1, ci, cj) < 0) return false;
+    }
+  }
+  return true;
+}
+
+void Quadtree::sum_over(const std::unordered_map<uint64_t, double>& old, int level, int I, int J,
+    double* sump, double* areap) const {
+  auto it = old.find(key(level, I, J));
+
+  if (it != old.end()) {
+    int s = max_level_ - level;
+    double area = (x_at((I + 1) << s) - x_at(I << s)) * (y_at((J + 1) << s) - y_at(J << s));
+    *sump += it->second * area;
+    *areap += area;
+    return;
+  }
+
+  assert(level < max_level_);
+  for (int a = 0; a < 2; ++a)
+    for (int b = 0; b < 2; ++b)
+      sum_over(old, level + 1, 2*I + a, 2*J + b, sump, areap);
+}
+
+bool Quadtree::adapt(const std::vector<int>& flags, Eigen::VectorXd* fp) {
+  assert(flags.size() == cells_.size() && (std::size_t)fp->size() == cells_.size());
+
+  Leaf_set S;
+  for (const Cell& c : cells_) S.insert(key(c.level, c.I, c.J));
+
+  // refine first, then coarsen what the refinement left balanced
+  for (std::size_t k = 0; k < cells_.size(); ++k) {
+    const Cell& c = cells_[k];
+    if (flags[k] > 0 && c.level < max_level_ && S.count(key(c.level, c.I, c.J)))
+      refine(&S, c.level, c.I, c.J);
+  }
+
+  for (std::size_t k = 0; k < cells_.size(); ++k) {
+    const Cell& c = cells_[k];
+    if (flags[k] >= 0 || c.level == 0) continue;
+
+    int l = c.level - 1, I = c.I >> 1, J = c.J >> 1;
+    bool all = true;
+    for (int a = 0; a < 2 && all; ++a) {
+      for (int b = 0; b < 2 && all; ++b) {
+        uint64_t ck = key(c.level, 2*I + a, 2*J + b);
+        auto it = index_.find(ck);
+        all = S.count(ck) && it != index_.end() && flags[it->second] < 0;
+      }
+    }
+    if (!all || !can_coarsen(S, l, I, J)) continue;
+
+    for (int a = 0; a < 2; ++a)
+      for (int b = 0; b < 2; ++b)
+        S.erase(key(c.level, 2*I + a, 2*J + b));
+    S.insert(key(l, I, J));
+  }
+
+  bool changed = S.size() != cells_.size();
+  for (std::size_t k = 0; k < cells_.size() && !changed; ++k)
+    changed = !S.count(key(cells_[k].level, cells_[k].I, cells_[k].J));
+  if (!changed) return false;
+
+  std::unordered_map<uint64_t, double> old;
+  for (std::size_t k = 0; k < cells_.size(); ++k)
+    old[key(cells_[k].level, cells_[k].I, cells_[k].J)] = (*fp)(k);
+
+  build(S);
+
+  Eigen::VectorXd& f = *fp;
+  f.resize(cells_.size());
+  for (std::size_t k = 0; k < cells_.size(); ++k) {
+    const Cell& c = cells_[k];
+
+    int l = c.level;
+    while (l >= 0 && !old.count(key(l, c.I >> (c.level - l), c.J >> (c.level - l)))) --l;
+
+    if (l >= 0) { // the cell or one of its ancestors was a leaf
+      f(k) = old[key(l, c.I >> (c.level - l), c.J >> (c.level - l))];
+    }
+    else { // the cell was split into finer leaves
+      double sum = 0, area = 0;
+      sum_over(old, c.level, c.I, c.J, &sum, &area);
+      f(k) = sum / area;
+    }
+  }
+
+  return true;
+}
+
+void Quadtree::build(const Leaf_set& S) {
+  int L = max_level_;
+  int level, I, J;
+
+  // order the leaves by their lower left corner, row by row
+  std::vector<std::pair<std::pair<int,int>, uint64_t>> order;
+  order.reserve(S.size());
+  for (uint64_t k : S) {
+    decode(k, &level, &I, &J);
+    order.push_back({{J << (L - level), I << (L - level)}, k});
+  }
+  std::sort(order.begin(), order.end());
+
+  std::size_t n = order.size();
+  cells_.resize(n);
+  centers_.resize(n);
+  areas_.resize(n);
+  index_.clear();
+
+  double x0, x1, y0, y1;
+  for (std::size_t k = 0; k < n; ++k) {
+    decode(order[k].second, &level, &I, &J);
+    cells_[k] = {level, I, J};
+    index_[order[k].second] = k;
+
+    bounds(k, &x0, &x1, &y0, &y1);
+    centers_[k] << (x0 + x1) / 2.0, (y0 + y1) / 2.0;
+    areas_[k] = (x1 - x0) * (y1 - y0);
+  }
+
+  // faces and vertices
+  std::unordered_map<uint64_t, int> vindex;
+  vertices_.clear();
+  vertex_sides_.clear();
+
+  int XN = m.nx() << L, YN = m.ny() << L;
+  auto vertex_id = [&](int X, int Y) {
+    uint64_t vk = ((uint64_t)X << 32) | (uint64_t)Y;
+    auto it = vindex.find(vk);
+    if (it != vindex.end()) return it->second;
+
+    int v = vertices_.size();
+    vindex[vk] = v;
+    vertices_.push_back(Point(x_at(X), y_at(Y)));
+    vertex_sides_.push_back((X == 0 ? 1 : 0) | (Y == YN ? 2 : 0) | (X == XN ? 4 : 0) | (Y == 0 ? 8 : 0));
+    return v;
+  };
+
+  face_begin_.assign(n + 1, 0);
+  faces_.clear();
+  faces_.reserve(4 * n);
+
+  for (std::size_t k = 0; k < n; ++k) {
+    const Cell& c = cells_[k];
+    int s = 1 << (L - c.level);
+    int X0 = c.I * s, X1 = X0 + s, Y0 = c.J * s, Y1 = Y0 + s;
+
+    // B, A and the midpoint of each side, in the integer coordinates of level L
+    int P[4][3][2] = {
+      {{X0, Y0}, {X0, Y1}, {X0, Y0 + s/2}},
+      {{X0, Y1}, {X1, Y1}, {X0 + s/2, Y1}},
+      {{X1, Y1}, {X1, Y0}, {X1, Y0 + s/2}},
+      {{X1, Y0}, {X0, Y0}, {X0 + s/2, Y0}}};
+
+    face_begin_[k] = faces_.size();
+
+    for (int side = 0; side < 4; ++side) {
+      int In = c.I + kDi[side], Jn = c.J + kDj[side];
+      int vB = vertex_id(P[side][0][0], P[side][0][1]);
+      int vA = vertex_id(P[side][1][0], P[side][1][1]);
+
+      Face face;
+      face.side = side;
+      face.twin = -1;
+
+      if (In < 0 || In >= nI(c.level) || Jn < 0 || Jn >= nJ(c.level)) { // boundary
+        face.vB = vB;
+        face.vA = vA;
+        face.nbr = -1;
+        faces_.push_back(face);
+        continue;
+      }
+
+      int lc = containing(S, c.level, In, Jn);
+      if (lc >= 0) { // one neighbor of the same or the next coarser level
+        face.vB = vB;
+        face.vA = vA;
+        face.nbr = index_[key(lc, In >> (c.level - lc), Jn >> (c.level - lc))];
+        faces_.push_back(face);
+        continue;
+      }
+
+      // two finer neighbors, the one next to B first
+      int vm = vertex_id(P[side][2][0], P[side][2][1]);
+      for (int half = 0; half < 2; ++half) {
+        // the child of (In, Jn) along the face that touches B (half 0) or A (half 1)
+        int ci, cj;
+        if (side == 0) { ci = 2*In + 1; cj = 2*Jn + half; }
+        else if (side == 1) { ci = 2*In + half; cj = 2*Jn; }
+        else if (side == 2) { ci = 2*In; cj = 2*Jn + 1 - half; }
+        else { ci = 2*In + 1 - half; cj = 2*Jn + 1; }
+
+        auto it = index_.find(key(c.level + 1, ci, cj));
+        assert(it != index_.end()); // balanced
+        face.vB = half == 0 ? vB : vm;
+        face.vA = half == 0 ? vm : vA;
+        face.nbr = it->second;
+        faces_.push_back(face);
+      }
+    }
+  }
+  face_begin_[n] = faces_.size();
+
+  // twins: the face from vA to vB of the neighbor
+  std::unordered_map<uint64_t, int> findex;
+  for (std::size_t h = 0; h < faces_.size(); ++h)
+    findex[((uint64_t)faces_[h].vB << 32) | (uint64_t)faces_[h].vA] = h;
+
+  for (Face& face : faces_) {
+    face.B = vertices_[face.vB];
+    face.A = vertices_[face.vA];
+    if (face.nbr >= 0) {
+      auto it = findex.find(((uint64_t)face.vA << 32) | (uint64_t)face.vB);
+      assert(it != findex.end());
+      face.twin = it->second;
+    }
+  }
+
+  // leaves around each vertex: each vertex of a leaf is the B of one of its faces
+  std::size_t nv = vertices_.size();
+  vertex_begin_.assign(nv + 1, 0);
+  for (const Face& face : faces_) ++vertex_begin_[face.vB + 1];
+  for (std::size_t v = 0; v < nv; ++v) vertex_begin_[v + 1] += vertex_begin_[v];
+
+  vertex_cells_.resize(vertex_begin_[nv]);
+  std::vector<int> pos(vertex_begin_.begin(), vertex_begin_.end() - 1);
+  for (std::size_t k = 0; k < n; ++k)
+    for (int h = face_begin_[k]; h < face_begin_[k+1]; ++h)
+      vertex_cells_[pos[faces_[h].vB]++] = k;
+}
@@ -0,0 +1,132 @@
+/*
+ * File:        Quadtree.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026
+ *
+ * Copyright (c) Xin Tao
+ *
+ */
+
+#ifndef QUADTREE_H_
+#define QUADTREE_H_
+
+#include "common.h"
+#include "Mesh.h"
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+//
+// A quadtree refinement of the cells of a Mesh.
+//
+// A cell at level l is cell (I, J) of the grid that splits each Mesh cell
+// into 2^l x 2^l equal cells; the Mesh cells are level 0. The leaves are
+// kept 2:1 balanced: leaves that share a face differ by at most one level.
+// A face of a leaf next to two finer leaves is split at the hanging node,
+// so that every face has exactly one neighbor, and a leaf is a polygon with
+// 4 to 8 faces in the PPFV scheme.
+//
+class Quadtree {
+  public:
+    Quadtree(const Mesh& m_in, int max_level);
+
+    struct Cell {
+      int level;
+      int I;
+      int J;
+    };
+
+    // A face of a leaf, oriented like the edges of Mesh: going from B to A
+    // the faces of a leaf go around it clockwise, and the side (inbr of Mesh)
+    // tells which side of the leaf the face is on.
+    struct Face {
+      Point A = {0, 0};
+      Point B = {0, 0};
+      int vA;   // the vertices at A and B
+      int vB;
+      int side;
+      int nbr;  // the neighbor leaf, or -1 on the boundary
+      int twin; // the same face in the face list of nbr, or -1 on the boundary
+    };
+
+    int max_level() const { return max_level_; }
+
+    std::size_t ncells() const { return cells_.size(); }
+    const Cell& cell(int k) const { return cells_[k]; }
+    const Point& center(int k) const { return centers_[k]; }
+    double area(int k) const { return areas_[k]; }
+
+    // the bounding box [x0, x1] x [y0, y1] of leaf k
+    void bounds(int k, double* x0p, double* x1p, double* y0p, double* y1p) const;
+
+    // the faces of leaf k are face(h), face_begin(k) <= h < face_end(k)
+    std::size_t nfaces() const { return faces_.size(); }
+    int face_begin(int k) const { return face_begin_[k]; }
+    int face_end(int k) const { return face_begin_[k+1]; }
+    const Face& face(int h) const { return faces_[h]; }
+
+    // The vertices are the face end points, hanging nodes included. The
+    // leaves around vertex v are vertex_cell(n), vertex_begin(v) <= n < vertex_end(v).
+    // vertex_sides(v) has bit s set if v lies on the boundary side s.
+    std::size_t nvertices() const { return vertices_.size(); }
+    const Point& vertex(int v) const { return vertices_[v]; }
+    int vertex_begin(int v) const { return vertex_begin_[v]; }
+    int vertex_end(int v) const { return vertex_begin_[v+1]; }
+    int vertex_cell(int n) const { return vertex_cells_[n]; }
+    int vertex_sides(int v) const { return vertex_sides_[v]; }
+
+    // Refine the leaves with flags[k] > 0, and coarsen each group of four
+    // sibling leaves that all have flags[k] < 0, within [0, max_level] and
+    // keeping the tree balanced (which may refine more leaves and coarsen
+    // fewer). The leaf values *fp are carried over: a new child gets the
+    // value of its parent, a new parent the area weighted mean of its
+    // children. Returns true if the leaves changed.
+    bool adapt(const std::vector<int>& flags, Eigen::VectorXd* fp);
+
+  private:
+    const Mesh& m;
+    int max_level_;
+
+    std::vector<Cell> cells_;
+    std::vector<Point> centers_;
+    std::vector<double> areas_;
+    std::unordered_map<uint64_t, int> index_; // key(cell) -> leaf index
+
+    std::vector<int> face_begin_;
+    std::vector<Face> faces_;
+
+    std::vector<Point> vertices_;
+    std::vector<int> vertex_begin_;
+    std::vector<int> vertex_cells_;
+    std::vector<int> vertex_sides_;
+
+    typedef std::unordered_set<uint64_t> Leaf_set;
+
+    static uint64_t key(int level, int I, int J) {
+      return ((uint64_t)level << 58) | ((uint64_t)I << 29) | (uint64_t)J;
+    }
+
+    int nI(int level) const { return m.nx() << level; }
+    int nJ(int level) const { return m.ny() << level; }
+
+    // the coordinates of the grid lines I and J of level max_level
+    double x_at(int I) const;
+    double y_at(int J) const;
+
+    // the level of the leaf in S that contains cell (level, I, J),
+    // or -1 if that cell is split into finer leaves
+    static int containing(const Leaf_set& S, int level, int I, int J);
+
+    void refine(Leaf_set* Sp, int level, int I, int J) const;
+    bool can_coarsen(const Leaf_set& S, int level, int I, int J) const;
+
+    // the area weighted sum of the old leaf values over cell (level, I, J)
+    void sum_over(const std::unordered_map<uint64_t, double>& old, int level, int I, int J,
+        double* sump, double* areap) const;
+
+    // the leaves, faces and vertices from the leaf set
+    void build(const Leaf_set& S);
+};
+
+#endif /* QUADTREE_H_ */
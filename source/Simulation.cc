@@ -0,0 +1,256 @@
+/*
+ * File:        Simulation.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#include <cassert>
+#include "Simulation.h"
+#include "utils.h"
+
+Simulation::Simulation(const Parameters& paras_in, const Mesh& m_in, D& d_in)
+  : paras(paras_in), m(m_in), d(d_in), bcs(paras_in), solver(paras_in, m_in, d_in, bcs), 
+    writer(paras_in, m_in), 
+    nonlinear_steps_(0), nonlinear_total_(0), nonlinear_max_(0), nonlinear_failed_(0) {
+
+  if (paras.profile()) {
+    profiler_.reset(new Profiler(paras)); 
+    solver.set_profiler(profiler_.get()); 
+  }
+}
+
+void Simulation::run(){
+
+  output_coordinates(); 
+
+  if (paras.nonlinear_iterate()) {
+    nonlinear_log_.open(paras.output_path() + "/" + paras.run_id() + "_nonlinear.dat"); 
+    assert(nonlinear_log_); 
+    nonlinear_log_ << "# t iterations relative_change" << std::endl; 
+  }
+
+  if (paras.amr()) 
+    run_amr(); 
+  else if (paras.unstructured()) 
+    run_poly(); 
+  else if (paras.adaptive_dt()) 
+    run_adaptive(); 
+  else 
+    run_fixed(); 
+
+  writer.flush(); 
+  if (profiler_) profiler_->finish(); 
+
+  if (paras.nonlinear_iterate()) {
+    nonlinear_log_.close(); 
+    std::cout << paras.run_id() << ": " << nonlinear_steps_ << " nonlinear solves, " 
+      << nonlinear_total_ << " iterations (max " << nonlinear_max_ << "), " 
+      << nonlinear_failed_ << " not converged" << std::endl; 
+  }
+}
+
+void Simulation::update_d(double t) {
+  Scoped_timer timer(profiler_.get(), Profiler::kD); 
+  d.updateCoefficients(t); 
+}
+
+// one solve of the solver; in the adaptive mode also the trial solves
+void Simulation::log_nonlinear() {
+  if (!paras.nonlinear_iterate()) return; 
+
+  int its = solver.nonlinear_iterations(); 
+  double err = solver.nonlinear_error(); 
+
+  nonlinear_log_ << solver.t() << " " << its << " " << err << "\n"; 
+
+  ++nonlinear_steps_; 
+  nonlinear_total_ += its; 
+  nonlinear_max_ = std::max(nonlinear_max_, its); 
+  if (err > paras.nonlinear_tol()) ++nonlinear_failed_; 
+}
+
+void Simulation::run_fixed(){
+
+  // Time loop for solving
+  for (int k = 1; k <= paras.nsteps(); ++k) {
+
+    // D at the end of the step, for the implicit scheme
+    update_d(solver.t() + m.dt()); 
+
+    // Solve using FVM solver
+    solver.update();
+    log_nonlinear(); 
+
+    if(k % paras.save_every_step() == 0) output_f(k / paras.save_every_step(), k); 
+    end_step(k, solver.t(), m.dt()); 
+  }
+}
+
+// Step doubling: a step of h is compared with two steps of h/2. The local 
+// error is O(h^2) for backward Euler and O(h^3) for BDF2, and so is the 
+// error estimate. 
+void Simulation::run_adaptive(){
+  const double order = paras.time_scheme() == "bdf2" ? 2 : 1; 
+  const double safety = 0.9; 
+  const double fac_min = 0.2; 
+  const double fac_max = 2.0; 
+  const double t_eps = 1e-12 * paras.T(); 
+
+  Solver::State s0; 
+  Eigen::MatrixXd f_full; 
+
+  double dt = std::min(paras.dt_max(), std::max(paras.dt_min(), paras.dt())); 
+  double t0, t_end, h, err, fac; 
+  bool cut; 
+  long naccepted = 0, nrejected = 0; 
+
+  for (int iplot = 1; iplot <= paras.nplots(); ++iplot) {
+    double t_plot = paras.T() * iplot / paras.nplots(); 
+
+    while (solver.t() < t_plot - t_eps) {
+      t0 = solver.t(); 
+
+      // end exactly at the output time and at kinks of D(t)
+      t_end = std::min(t_plot, d.next_change(t0 + t_eps)); 
+      h = dt; 
+      cut = false; 
+      if (t0 + h > t_end - t_eps) { h = t_end - t0; cut = true; }
+      else if (t0 + 2*h > t_end) { h = (t_end - t0) / 2; cut = true; } // no tiny step after this one
+
+      solver.save_state(&s0); 
+
+      update_d(t0 + h); 
+      solver.update(h); 
+      log_nonlinear(); 
+      f_full = solver.f(); 
+
+      solver.restore_state(s0); 
+      update_d(t0 + h/2); 
+      solver.update(h/2); 
+      log_nonlinear(); 
+      update_d(t0 + h); 
+      solver.update(h/2); 
+      log_nonlinear(); 
+
+      err = ((solver.f() - f_full).array().abs() / 
+          (paras.dt_atol() + paras.dt_rtol() * solver.f().array().abs())).maxCoeff(); 
+
+      fac = err > 0 ? safety * std::pow(err, -1.0 / (order + 1)) : fac_max; 
+      fac = std::min(fac_max, std::max(fac_min, fac)); 
+
+      if (err <= 1.0 || h <= paras.dt_min()) {
+        ++naccepted; 
+        if (!cut || fac < 1.0) dt = h * fac; // a step cut short says little about a larger dt
+      }
+      else {
+        ++nrejected; 
+        solver.restore_state(s0); 
+        dt = h * fac; 
+      }
+
+      dt = std::min(paras.dt_max(), std::max(paras.dt_min(), dt)); 
+      end_step(naccepted + nrejected, solver.t(), h); 
+    }
+
+    output_f(iplot, naccepted); 
+  }
+
+  std::cout << paras.run_id() << ": " << naccepted << " steps accepted, " 
+    << nrejected << " rejected" << std::endl; 
+}
+
+void Simulation::run_amr(){
+  Amr_solver amr(paras, m, d, bcs); 
+  std::size_t nmin = amr.tree().ncells(), nmax = nmin; 
+
+  for (int k = 1; k <= paras.nsteps(); ++k) {
+    amr.update(m.dt()); 
+
+    if (k % paras.amr_interval() == 0 && amr.adapt()) {
+      nmin = std::min(nmin, amr.tree().ncells()); 
+      nmax = std::max(nmax, amr.tree().ncells()); 
+    }
+
+    if(k % paras.save_every_step() == 0) output_amr(amr, k / paras.save_every_step(), k); 
+    end_step(k, amr.t(), m.dt()); 
+  }
+
+  std::cout << paras.run_id() << ": " << nmin << " to " << nmax << " AMR cells, " 
+    << amr.tree().ncells() << " at the end" << std::endl; 
+}
+
+void Simulation::output_amr(const Amr_solver& amr, int iplot, int step) const {
+  Scoped_timer timer(profiler_.get(), Profiler::kOutput); 
+  string filename = paras.output_path() + "/" + paras.run_id() + std::to_string(iplot) + ".dat"; 
+  ofstream out(filename); 
+  assert(out); 
+
+  const Quadtree& tree = amr.tree(); 
+  double x0, x1, y0, y1; 
+
+  out << "# t = " << amr.t() << ", step = " << step << ", cells = " << tree.ncells() << "\n"; 
+  out << std::setprecision(10); 
+  for (std::size_t k = 0; k < tree.ncells(); ++k) {
+    tree.bounds(k, &x0, &x1, &y0, &y1); 
+    out << x0 << " " << x1 << " " << y0 << " " << y1 << " " << amr.f()(k) << "\n"; 
+  }
+}
+
+void Simulation::run_poly(){
+  Poly_mesh pm(paras, paras.mesh_file()); 
+  Poly_solver ps(paras, m, pm, d, bcs); 
+
+  std::cout << paras.run_id() << ": " << pm.ncells() << " cells, " << pm.nfaces() << " faces, " 
+    << pm.nvertices() << " vertices" << std::endl; 
+
+  for (int k = 1; k <= paras.nsteps(); ++k) {
+    ps.update(m.dt()); 
+
+    if(k % paras.save_every_step() == 0) output_poly(ps, k / paras.save_every_step(), k); 
+    end_step(k, ps.t(), m.dt()); 
+  }
+}
+
+void Simulation::output_poly(const Poly_solver& ps, int iplot, int step) const {
+  Scoped_timer timer(profiler_.get(), Profiler::kOutput); 
+  string filename = paras.output_path() + "/" + paras.run_id() + std::to_string(iplot) + ".dat"; 
+  ofstream out(filename); 
+  assert(out); 
+
+  const Poly_mesh& pm = ps.mesh(); 
+
+  out << "# t = " << ps.t() << ", step = " << step << ", cells = " << pm.ncells() << "\n"; 
+  out << std::setprecision(10); 
+  for (std::size_t k = 0; k < pm.ncells(); ++k) 
+    out << pm.center(k)(0) << " " << pm.center(k)(1) << " " << pm.area(k) << " " << ps.f()(k) << "\n"; 
+}
+
+void Simulation::output_coordinates() const {
+  string filename;
+  ofstream out; 
+
+  Eigen::VectorXd a0(m.nx()), E(m.ny()); 
+
+  filename = paras.output_path() + "/" + paras.run_id() + "_a0.dat";
+  out.open(filename); 
+  assert(out);
+  a0 = m.x() * 180.0/gPI; 
+  out << a0 << std::endl;  
+  out.close();
+
+  filename = paras.output_path() + "/" + paras.run_id() + "_E.dat";
+  out.open(filename); 
+  assert(out);
+  for (std::size_t i=0; i<m.ny(); ++i) E(i) = p2e(m.p(i), gE0);
+  out << E << std::endl;  
+  out.close();
+}
+
+void Simulation::output_f(int iplot, int step) {
+  Scoped_timer timer(profiler_.get(), Profiler::kOutput); 
+  string filename = paras.output_path() + "/" + paras.run_id() + std::to_string(iplot);
+  writer.write(filename, step, solver.t(), solver.f()); 
+}
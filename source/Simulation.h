@@ -0,0 +1,70 @@
+/*
+ * File:        Simulation.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include "common.h"
+#include "Parameters.h"
+#include "Mesh.h"
+#include "D.h"
+#include "BCs.h"
+#include "Solver.h"
+#include "Amr_solver.h"
+#include "Poly_solver.h"
+#include "Snapshot_writer.h"
+#include "Profiler.h"
+
+//
+// One run: the time loop and the output of a Solver. 
+// The Mesh is only read, and so is D unless it is time dependent, so they 
+// may be shared by several simulations running at the same time (see Ensemble). 
+//
+class Simulation {
+  public:
+    Simulation(const Parameters& paras_in, const Mesh& m_in, D& d_in);
+
+    void run(); 
+
+  private:
+    const Parameters& paras; 
+    const Mesh& m; 
+    D& d; 
+
+    BCs bcs; 
+    Solver solver; 
+    Snapshot_writer writer; 
+
+    // the wall clock profile, if enabled; null otherwise
+    std::unique_ptr<Profiler> profiler_; 
+    void end_step(long step, double t, double dt) { if (profiler_) profiler_->end_step(step, t, dt); }
+
+    // statistics of the nonlinear iterations, if enabled
+    ofstream nonlinear_log_; 
+    long nonlinear_steps_; 
+    long nonlinear_total_; 
+    int nonlinear_max_; 
+    long nonlinear_failed_; 
+
+    void log_nonlinear(); 
+
+    void update_d(double t); // d.updateCoefficients(t), timed
+
+    void run_fixed(); 
+    void run_adaptive(); 
+    void run_amr(); 
+    void run_poly(); 
+
+    void output_coordinates() const; 
+    void output_f(int iplot, int step); 
+    void output_amr(const Amr_solver& amr, int iplot, int step) const; 
+    void output_poly(const Poly_solver& ps, int iplot, int step) const; 
+}; 
+
+#endif /* SIMULATION_H_ */
@@ -0,0 +1,125 @@
+/*
+ * File:        Snapshot.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Snapshot.h"
+
+static bool host_is_little_endian(){
+  const uint16_t one = 1; 
+  return *reinterpret_cast<const unsigned char*>(&one) == 1; 
+}
+
+// copy n bytes of a little-endian number from/to native order
+static void le_copy(void* dst, const void* src, std::size_t n){
+  if (host_is_little_endian()) {
+    std::memcpy(dst, src, n); 
+  }
+  else {
+    for (std::size_t k = 0; k < n; ++k) 
+      static_cast<unsigned char*>(dst)[k] = static_cast<const unsigned char*>(src)[n-1-k]; 
+  }
+}
+
+template<typename V>
+static void put(char* buf, std::size_t offset, V v){ le_copy(buf + offset, &v, sizeof(V)); }
+
+template<typename V>
+static V get(const char* buf, std::size_t offset){ V v; le_copy(&v, buf + offset, sizeof(V)); return v; }
+
+static void write_doubles(ofstream& out, const double* v, std::size_t n){
+  if (host_is_little_endian()) {
+    out.write(reinterpret_cast<const char*>(v), n * sizeof(double)); 
+  }
+  else {
+    char buf[sizeof(double)]; 
+    for (std::size_t k = 0; k < n; ++k) {
+      put<double>(buf, 0, v[k]); 
+      out.write(buf, sizeof(double)); 
+    }
+  }
+}
+
+void write_snapshot(const string& filename, long step, double t, 
+    const Eigen::VectorXd& x, const Eigen::VectorXd& y, const Eigen::MatrixXd& f){
+
+  assert((std::size_t)f.rows() == (std::size_t)x.size() && (std::size_t)f.cols() == (std::size_t)y.size()); 
+
+  char header[gSnapshotHeaderSize] = {0}; 
+  std::memcpy(header, gSnapshotMagic, 8); 
+  put<uint32_t>(header, 8, gSnapshotVersion); 
+  put<uint32_t>(header, 12, gSnapshotHeaderSize + sizeof(double) * (x.size() + y.size())); 
+  put<uint64_t>(header, 16, x.size()); 
+  put<uint64_t>(header, 24, y.size()); 
+  put<int64_t>(header, 32, step); 
+  put<double>(header, 40, t); 
+
+  ofstream out(filename, std::ios::binary); 
+  assert(out); 
+  out.write(header, gSnapshotHeaderSize); 
+  write_doubles(out, x.data(), x.size()); 
+  write_doubles(out, y.data(), y.size()); 
+  write_doubles(out, f.data(), f.size()); 
+  out.close(); 
+}
+
+
+Snapshot_reader::Snapshot_reader(const string& filename): map_(MAP_FAILED), map_size_(0) {
+
+  int fd = open(filename.c_str(), O_RDONLY); 
+  struct stat st; 
+
+  if (fd < 0 || fstat(fd, &st) != 0 || (std::size_t)st.st_size < gSnapshotHeaderSize) {
+    std::cerr << "Snapshot_reader: cannot read " << filename << std::endl; 
+    exit(1); 
+  }
+
+  map_size_ = st.st_size; 
+  map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0); 
+  close(fd); 
+
+  if (map_ == MAP_FAILED) {
+    std::cerr << "Snapshot_reader: cannot map " << filename << std::endl; 
+    exit(1); 
+  }
+
+  const char* buf = static_cast<const char*>(map_); 
+  uint32_t version = get<uint32_t>(buf, 8); 
+  uint32_t offset = get<uint32_t>(buf, 12); 
+  nx_ = get<uint64_t>(buf, 16); 
+  ny_ = get<uint64_t>(buf, 24); 
+  step_ = get<int64_t>(buf, 32); 
+  t_ = get<double>(buf, 40); 
+
+  std::size_t ndata = nx_ + ny_ + nx_ * ny_; 
+
+  if (std::memcmp(buf, gSnapshotMagic, 8) != 0 || version != gSnapshotVersion || 
+      offset != gSnapshotHeaderSize + sizeof(double) * (nx_ + ny_) || 
+      map_size_ != gSnapshotHeaderSize + sizeof(double) * ndata) {
+    std::cerr << "Snapshot_reader: " << filename << " is not a version " << gSnapshotVersion 
+      << " snapshot" << std::endl; 
+    exit(1); 
+  }
+
+  data_ = reinterpret_cast<const double*>(buf + gSnapshotHeaderSize); 
+
+  if (!host_is_little_endian()) {
+    swapped_.resize(ndata); 
+    for (std::size_t k = 0; k < ndata; ++k) swapped_[k] = get<double>(buf, gSnapshotHeaderSize + k * sizeof(double)); 
+    data_ = swapped_.data(); 
+  }
+}
+
+Snapshot_reader::~Snapshot_reader(){
+  if (map_ != MAP_FAILED) munmap(map_, map_size_); 
+}
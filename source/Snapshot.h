@@ -0,0 +1,75 @@
+/*
+ * File:        Snapshot.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include "common.h"
+
+//
+// Binary snapshot of f. All numbers are little-endian. 
+//
+//   offset  size        content
+//   0       8           magic "FVM2DSNP"
+//   8       4           uint32 format version (1)
+//   12      4           uint32 offset of the data, 64 + 8*(nx+ny)
+//   16      8           uint64 nx
+//   24      8           uint64 ny
+//   32      8           int64  step
+//   40      8           double t (days)
+//   48      16          reserved (zero)
+//   64      8*nx        double alpha0 of the cell centers (radian)
+//   ...     8*ny        double log(p) of the cell centers
+//   ...     8*nx*ny     double f(i,j) at position j*nx+i, the order of Mesh::ind2to1
+//
+// The data are 8-byte aligned, so a mapped file can be used in place. 
+//
+const char gSnapshotMagic[9] = "FVM2DSNP"; 
+const uint32_t gSnapshotVersion = 1; 
+const std::size_t gSnapshotHeaderSize = 64; 
+
+void write_snapshot(const string& filename, long step, double t, 
+    const Eigen::VectorXd& x, const Eigen::VectorXd& y, const Eigen::MatrixXd& f); 
+
+// Maps a snapshot file into memory. On little-endian hosts x(), y() and f() 
+// refer to the mapped file directly; otherwise the data are copied and swapped. 
+class Snapshot_reader {
+  public:
+    Snapshot_reader(const string& filename); 
+    ~Snapshot_reader(); 
+
+    Snapshot_reader(const Snapshot_reader&) = delete; 
+    Snapshot_reader& operator=(const Snapshot_reader&) = delete; 
+
+    std::size_t nx() const { return nx_; }
+    std::size_t ny() const { return ny_; }
+    long step() const { return step_; }
+    double t() const { return t_; }
+
+    Eigen::Map<const Eigen::VectorXd> x() const { return Eigen::Map<const Eigen::VectorXd>(data_, nx_); }
+    Eigen::Map<const Eigen::VectorXd> y() const { return Eigen::Map<const Eigen::VectorXd>(data_ + nx_, ny_); }
+    Eigen::Map<const Eigen::MatrixXd> f() const { return Eigen::Map<const Eigen::MatrixXd>(data_ + nx_ + ny_, nx_, ny_); }
+
+  private:
+    void* map_; 
+    std::size_t map_size_; 
+
+    std::size_t nx_; 
+    std::size_t ny_; 
+    long step_; 
+    double t_; 
+
+    const double* data_; 
+    std::vector<double> swapped_; // used on big-endian hosts only
+}; 
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,106 @@
+/*
+ * File:        Snapshot_writer.cc
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#include <cassert>
+#include "Snapshot_writer.h"
+#include "Snapshot.h"
+
+Snapshot_writer::Snapshot_writer(const Parameters& paras_in, const Mesh& m_in)
+  : paras(paras_in), m(m_in), async_(paras_in.async_output() != 0), nbusy_(0), stop_(false) {
+
+  if (async_) {
+    assert(paras.output_buffers() > 0); 
+
+    buffers_.resize(paras.output_buffers()); 
+    for (int k = 0; k < paras.output_buffers(); ++k) {
+      buffers_[k].resize(m.nx(), m.ny()); 
+      free_.push_back(k); 
+    }
+
+    thread_ = std::thread(&Snapshot_writer::loop, this); 
+  }
+}
+
+Snapshot_writer::~Snapshot_writer(){
+  if (async_) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_); 
+      stop_ = true; 
+    }
+    cv_.notify_all(); 
+    thread_.join(); 
+  }
+}
+
+void Snapshot_writer::write(const string& filename, long step, double t, const Eigen::MatrixXd& f){
+
+  Job job = {filename, step, t, -1}; 
+
+  if (!async_) {
+    write_file(job, f); 
+    return; 
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_); 
+  cv_.wait(lock, [this]{ return !free_.empty(); }); // back pressure
+
+  job.ibuf = free_.back(); 
+  free_.pop_back(); 
+  ++nbusy_; 
+
+  // the buffer is ours until the writer thread returns it, 
+  // so the copy does not need to hold the lock
+  lock.unlock(); 
+  buffers_[job.ibuf] = f; 
+  lock.lock(); 
+
+  jobs_.push_back(job); 
+  lock.unlock(); 
+  cv_.notify_all(); 
+}
+
+void Snapshot_writer::flush(){
+  if (!async_) return; 
+
+  std::unique_lock<std::mutex> lock(mutex_); 
+  cv_.wait(lock, [this]{ return nbusy_ == 0; }); 
+}
+
+// the background thread; it drains the queue before stopping
+void Snapshot_writer::loop(){
+  std::unique_lock<std::mutex> lock(mutex_); 
+
+  while (true) {
+    cv_.wait(lock, [this]{ return stop_ || !jobs_.empty(); }); 
+    if (jobs_.empty()) break; // stop_ is set and nothing is left
+
+    Job job = jobs_.front(); 
+    jobs_.pop_front(); 
+
+    lock.unlock(); 
+    write_file(job, buffers_[job.ibuf]); 
+    lock.lock(); 
+
+    free_.push_back(job.ibuf); 
+    --nbusy_; 
+    cv_.notify_all(); 
+  }
+}
+
+void Snapshot_writer::write_file(const Job& job, const Eigen::MatrixXd& f) const {
+  if (paras.output_format() == "binary") {
+    write_snapshot(job.filename + ".bin", job.step, job.t, m.x(), m.y(), f); 
+    return; 
+  }
+
+  ofstream out(job.filename);
+  assert(out); 
+  out << f; 
+  out.close();
+}
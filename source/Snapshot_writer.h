@@ -0,0 +1,65 @@
+/*
+ * File:        Snapshot_writer.h
+ * Author:      Xin Tao <xtao@ustc.edu.cn>
+ * Date:        10/17/2026 
+ * 
+ * Copyright (c) Xin Tao 
+ *
+ */
+
+#ifndef SNAPSHOT_WRITER_H_
+#define SNAPSHOT_WRITER_H_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "common.h"
+#include "Parameters.h"
+#include "Mesh.h"
+
+//
+// Writes the snapshots of f, in the format given by paras.output_format(). 
+//
+// With async_output, write() only copies f into one of output_buffers 
+// buffers and returns; a background thread formats and writes the file 
+// while the solver goes on. write() waits only when all buffers are in use. 
+//
+class Snapshot_writer {
+  public:
+    Snapshot_writer(const Parameters& paras_in, const Mesh& m_in); 
+    ~Snapshot_writer(); 
+
+    void write(const string& filename, long step, double t, const Eigen::MatrixXd& f); 
+
+    // wait until all queued snapshots are on disk
+    void flush(); 
+
+  private:
+    struct Job {
+      string filename; 
+      long step; 
+      double t; 
+      int ibuf; 
+    }; 
+
+    const Parameters& paras; 
+    const Mesh& m; 
+
+    bool async_; 
+    std::vector<Eigen::MatrixXd> buffers_; 
+    std::vector<int> free_; // indices of the buffers not in use
+    std::deque<Job> jobs_; 
+    int nbusy_; // jobs queued or being written
+
+    bool stop_; 
+    std::mutex mutex_; 
+    std::condition_variable cv_; 
+    std::thread thread_; 
+
+    void write_file(const Job& job, const Eigen::MatrixXd& f) const; 
+    void loop(); 
+}; 
+
+#endif /* SNAPSHOT_WRITER_H_ */
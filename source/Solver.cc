@@ -12,9 +12,10 @@
 #include "Solver.h"
 #include "Parameters.h"
 #include <limits>
+#include <algorithm>
 
 Solver::Solver(const Parameters& paras_in, const Mesh& m_in, const D& d_in, const BCs& bcs_in)
-  : paras(paras_in), m(m_in), d(d_in), bcs(bcs_in){
+  : paras(paras_in), m(m_in), d(d_in), bcs(bcs_in), prof_(nullptr){
 
     std::size_t nx = m.nx();
     std::size_t ny = m.ny();
@@ -26,13 +27,37 @@ Solver::Solver(const Parameters& paras_in, const Mesh& m_in, const D& d_in, cons
     R_.resize(nx*ny);
 
     alpha_osf_.resize({nx, ny, m.nnbrs()});
-    vertex_f_.resize({nx+1, ny+1});
+    vertex_f_.resize(nx+1, ny+1);
+
+    vertex_wx_.setZero(nx); 
+    vertex_wy_.setZero(ny); 
+    for (std::size_t i=1; i<nx; ++i) vertex_wx_(i) = (m.xv(i) - m.x(i-1)) / (m.x(i) - m.x(i-1)); 
+    for (std::size_t j=1; j<ny; ++j) vertex_wy_(j) = (m.yv(j) - m.y(j-1)) / (m.y(j) - m.y(j-1)); 
+
+    slot_.resize({nx, ny, m.nnbrs()});
+    diag_slot_.resize(nx*ny); 
+    G_.resize(nx*ny); 
+    mass_.resize(nx*ny); 
+    h_.resize(nx, ny); 
+    f_star_.resize(nx, ny); 
+
+    bdf2_ = paras.time_scheme() == "bdf2"; 
+
+    static void (Solver::*const assemble_table[2])() = {
+      &Solver::assemble_cells<Bc_zero_slope>, // alpha0_min_bct == 0
+      &Solver::assemble_cells<Bc_loss_cone>
+    }; 
+    assemble_cells_ = assemble_table[paras.alpha0_min_bct() != 0]; 
+
+    lsolver_ = make_linear_solver(paras); 
+
+    build_pattern(); 
 
     init(); 
 
   }
 
-double Solver::bounce_period(double a0, double p) const{
+double Solver::bounce_period(double L, double a0, double p) {
   double T0 = 1.3802;
   double T1 = 0.7405;
   double y; 
@@ -41,7 +66,7 @@ double Solver::bounce_period(double a0, double p) const{
   y = std::sin(a0); 
   Ty = T0 - 0.5 * (T0 - T1) * (y + sqrt(y));
 
-  return 4*paras.L() * gRE * ((gE0 + p2e(p, gE0)) / (gC * gC)) / p * Ty / (3e8 * 3600 * 24); 
+  return 4*L * gRE * ((gE0 + p2e(p, gE0)) / (gC * gC)) / p * Ty / (3e8 * 3600 * 24); 
 }
 
 void Solver::init(){
@@ -55,7 +80,7 @@ void Solver::init(){
       f_(i,j) = bcs.init_f(a0, p);
 
       if (a0 < paras.alpha0_lc()) {
-        tau_(i,j) = bounce_period(a0, p) / 4.0;  
+        tau_(i,j) = bounce_period(paras.L(), a0, p) / 4.0;  
       }
       else {
         tau_(i,j) = std::numeric_limits<double>::max();
@@ -64,6 +89,10 @@ void Solver::init(){
   }
 
   t_ = 0;
+  dt_prev_ = 0; 
+  nonlinear_iterations_ = 0; 
+  nonlinear_error_ = 0.0; 
+  f_lin_ = &f_; 
   construct_alpha_osf();
   update_vertex_f();
 }
@@ -87,44 +116,59 @@ void Solver::alpha_osf_func(const Eigen::Matrix2d& Lambda_K, const Point& K, con
 
 
 void Solver::construct_alpha_osf(){
+  construct_alpha_osf(0, m.nx(), 0, m.ny()); 
+  d_version_ = d.version(); 
+}
 
-  Eigen::Matrix2d Lambda_K;
+// recompute alpha_osf_ only in the tiles where d changed
+void Solver::update_alpha_osf(){
+  if (d.version() == d_version_) return; 
 
-  double x, y, p, a0;
-  Point K;
-  Edge edge;  
+  if (d.version() != d_version_ + 1) { // missed an update of d; the dirty mask is not enough
+    construct_alpha_osf(); 
+    return; 
+  }
 
-  for (std::size_t i = 0; i < m.nx(); i++){
-    x = m.x(i);
-    a0 = x; 
-    for (std::size_t j = 0; j < m.ny(); j++){
-      y = m.y(j);
-      p = m.p(j); 
+  for (std::size_t it = 0; it < d.ntiles_x(); ++it) 
+    for (std::size_t jt = 0; jt < d.ntiles_y(); ++jt) {
+      if (d.tile_dirty(it, jt)) 
+        construct_alpha_osf(it*D::kTile, std::min((it+1)*D::kTile, m.nx()), 
+                            jt*D::kTile, std::min((jt+1)*D::kTile, m.ny())); 
+    }
 
-      Lambda_K << d.Daa(t(), i, j) * G(a0, p), d.Day(t(), i, j) * G(a0, p), 
-               d.Day(t(), i, j) * G(a0, p), d.Dyy(t(), i, j) * G(a0, p);
+  d_version_ = d.version(); 
+}
 
-      K  << x, y;
+// [i0, i1) x [j0, j1)
+// The cells of Mesh are axis-aligned rectangles with K at their centers, so 
+// the closed form alpha_osf_rect gives the same coefficients as 
+// alpha_osf_func up to round-off. 
+void Solver::construct_alpha_osf(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1){
 
-      for (size_t inbr=0; inbr<m.nnbrs(); ++inbr){
-        m.get_nbr_edg(i, j, inbr, &edge);  
-        alpha_osf_func(Lambda_K, K, edge.A, edge.B, &alpha_osf_(i,j, inbr)); 
-      }
+  #pragma omp parallel for schedule(static)
+  for (std::size_t j = j0; j < j1; j++){
+    double p = m.p(j); 
+    double hy = m.dy(j); 
+    NTPFA_node nodes[4]; 
+
+    for (std::size_t i = i0; i < i1; i++){
+      double g = G(m.x(i), p); 
+
+      alpha_osf_rect(d.Daa(t(), i, j) * g, d.Day(t(), i, j) * g, d.Dyy(t(), i, j) * g, 
+          m.dx(i), hy, nodes); 
+      for (int inbr = 0; inbr < 4; ++inbr) alpha_osf_(i,j,inbr) = nodes[inbr]; 
     }
   }
 }
 
-void Solver::coeff_add_inner(int i, int j, int inbr){
+template <int inbr>
+void Solver::coeff_add_inner(int i, int j){
   Ind ind; 
-  Edge edge; 
-  m.get_nbr_edg(i, j, inbr, &edge); 
   m.get_nbr_ind(i, j, inbr, &ind); 
 
   Ind indA, indB; 
-  m.indO(edge.A, &indA); 
+  m.get_nbr_vertices(i, j, inbr, &indA, &indB); 
   double fA = vertex_f_(indA.i, indA.j); 
-
-  m.indO(edge.B, &indB); 
   double fB = vertex_f_(indB.i,indB.j); 
 
   double aK = alpha_osf_(i,j,inbr).A * fA + alpha_osf_(i,j,inbr).B * fB;
@@ -139,131 +183,429 @@ void Solver::coeff_add_inner(int i, int j, int inbr){
   double B_sigma_p = bsigma_plus(B_sigma);
   double B_sigma_n = bsigma_minus(B_sigma);
 
-  double A_K = muK * (alpha_osf_(i,j, inbr).A + alpha_osf_(i,j, inbr).B) + B_sigma_p / (f_(i, j) + 1e-15);
-  double A_L = muL * (alpha_osf_(ind.i,ind.j, rinbr).A + alpha_osf_(ind.i,ind.j, inbr).B) + B_sigma_n / (f_(ind.i, ind.j) + 1e-15);
+  double A_K = muK * (alpha_osf_(i,j, inbr).A + alpha_osf_(i,j, inbr).B) + B_sigma_p / ((*f_lin_)(i, j) + 1e-15);
+  double A_L = muL * (alpha_osf_(ind.i,ind.j, rinbr).A + alpha_osf_(ind.i,ind.j, inbr).B) + B_sigma_n / ((*f_lin_)(ind.i, ind.j) + 1e-15);
 
-  long ii = m.ind2to1(i,j), jj = m.ind2to1(ind.i, ind.j); 
-  M_coeffs_.push_back(T(ii, ii, A_K));
-  M_coeffs_.push_back(T(ii, jj, -A_L));
+  double* val = M_.valuePtr(); 
+  val[diag_slot_(m.ind2to1(i,j))] += A_K; 
+  val[slot_(i,j,inbr)] -= A_L; 
 
 }
 
-void Solver::coeff_add_dirbc(int i, int j, int inbr) {  
-  Edge edge; 
-  m.get_nbr_edg(i, j, inbr, &edge); 
-
+template <int inbr>
+void Solver::coeff_add_dirbc(int i, int j) {  
   Ind indA, indB; 
-  m.indO(edge.A, &indA); 
+  m.get_nbr_vertices(i, j, inbr, &indA, &indB); 
   double fA = vertex_f_(indA.i, indA.j); 
-
-  m.indO(edge.B, &indB); 
   double fB = vertex_f_(indB.i,indB.j); 
 
   double aK = alpha_osf_(i,j,inbr).A * fA + alpha_osf_(i,j,inbr).B * fB; 
 
   long ii = m.ind2to1(i,j);
   R_(ii) += aK; 
-  M_coeffs_.push_back(T(ii, ii, (alpha_osf_(i,j,inbr).A + alpha_osf_(i,j,inbr).B)));
+  M_.valuePtr()[diag_slot_(ii)] += alpha_osf_(i,j,inbr).A + alpha_osf_(i,j,inbr).B;
 }
 
 
-void Solver::assemble(){ // obtain M and R 
+void Solver::build_pattern(){ // the structure of M, fixed by the mesh connectivity
+
+  std::vector<T> coeffs; 
+  coeffs.reserve(m.nx()*m.ny()*(m.nnbrs()+1)); 
 
-  // inner cells
-  for (std::size_t i=1; i<m.nx()-1; ++i){
-    for (std::size_t j=1; j<m.ny()-1; ++j){
+  Ind ind; 
+  long ii; 
+  double a0, p; 
 
-      for (size_t inbr = 0; inbr < m.nnbrs(); ++inbr) 
-        coeff_add_inner(i, j, inbr);
+  for (std::size_t i=0; i<m.nx(); ++i) {
+    a0 = m.x(i); 
+    for (std::size_t j=0; j<m.ny(); ++j) {
+      p = m.p(j); 
+      ii = m.ind2to1(i,j); 
+      coeffs.push_back(T(ii, ii, 0.0)); 
+
+      for (std::size_t inbr=0; inbr<m.nnbrs(); ++inbr) {
+        m.get_nbr_ind(i, j, inbr, &ind); 
+
+        if (ind.i >= 0 && ind.i < (int)m.nx() && ind.j >= 0 && ind.j < (int)m.ny()) 
+          coeffs.push_back(T(ii, m.ind2to1(ind.i, ind.j), 0.0)); 
+      }
+
+      G_(ii) = G(a0, p) * m.area(i,j); 
     }
   }
 
-  // row: i == 0 
-  for (std::size_t j=0; j<m.ny(); ++j) {
-    coeff_add_inner(0,j,m.inbr_ip());
-  }
+  M_.setFromTriplets(coeffs.begin(), coeffs.end()); 
+  M_.makeCompressed(); 
+
+  mass_dt_ = 0.0; 
+
+  const double* val = M_.valuePtr(); 
 
-  if (paras.alpha0_min_bct() != 0) { // Dirichilet bc at alpha0 = alpha0_lc
+  for (std::size_t i=0; i<m.nx(); ++i) {
     for (std::size_t j=0; j<m.ny(); ++j) {
-      coeff_add_dirbc(0,j,m.inbr_im()); 
+      ii = m.ind2to1(i,j); 
+      diag_slot_(ii) = &M_.coeffRef(ii, ii) - val; 
+
+      for (std::size_t inbr=0; inbr<m.nnbrs(); ++inbr) {
+        m.get_nbr_ind(i, j, inbr, &ind); 
+
+        if (ind.i >= 0 && ind.i < (int)m.nx() && ind.j >= 0 && ind.j < (int)m.ny()) 
+          slot_(i,j,inbr) = &M_.coeffRef(ii, m.ind2to1(ind.i, ind.j)) - val; 
+        else if ((int)inbr == m.inbr_ip()) // nothing special for alpha=90 
+          slot_(i,j,inbr) = kSlotNone; 
+        else if ((int)inbr == m.inbr_im() && paras.alpha0_min_bct() == 0) // df/da0 = 0 at alpha0 = 0
+          slot_(i,j,inbr) = kSlotNone; 
+        else
+          slot_(i,j,inbr) = kSlotDirbc; 
+      }
     }
   }
 
-  for (std::size_t j=1; j<m.ny(); ++j) coeff_add_inner(0,j,m.inbr_jm());
-  for (std::size_t j=0; j<m.ny()-1; ++j) coeff_add_inner(0,j,m.inbr_jp());
+  pattern_analyzed_ = false; 
+}
+
+void Solver::assemble(){ // obtain M and R 
+  (this->*assemble_cells_)(); 
+}
 
-  // row i == nx-1 alpha = 90 
-  for (std::size_t j=0; j<m.ny(); ++j) {
-    coeff_add_inner(m.nx()-1,j,m.inbr_im()); 
-    // nothing special for alpha=90 for inbr=inbr_ip()
+// Vectorized along i, as in assemble_cells: the neighbor, the vertices and 
+// the reverse edge of the inbr edge are at fixed offsets from (i,j). 
+template <int inbr>
+void Solver::inner_fluxes(int j, int i0, int i1, double* A_Kp, double* A_Lp) const {
+  Ind ind, indA, indB; 
+  m.get_nbr_ind(i0, j, inbr, &ind); 
+  m.get_nbr_vertices(i0, j, inbr, &indA, &indB); 
+  const int rinbr = (inbr + 2) % 4; // m.rinbr(inbr)
+
+  const NTPFA_node* aKs = &alpha_osf_(i0, j, inbr); 
+  const NTPFA_node* aLs = &alpha_osf_(ind.i, ind.j, rinbr); 
+  const NTPFA_node* aLb = &alpha_osf_(ind.i, ind.j, inbr); // see A_L in coeff_add_inner
+  const double* fAs = &vertex_f_(indA.i, indA.j); 
+  const double* fBs = &vertex_f_(indB.i, indB.j); 
+  const double* fK = &(*f_lin_)(i0, j); 
+  const double* fL = &(*f_lin_)(ind.i, ind.j); 
+
+  #pragma omp simd
+  for (int n = 0; n < i1 - i0; ++n) {
+    double fA = fAs[n]; 
+    double fB = fBs[n]; 
+
+    double aK = aKs[n].A * fA + aKs[n].B * fB; 
+    double aL = aLs[n].A * fB + aLs[n].B * fA; 
+
+    double muK = coeff_mu(aK, aL); 
+    double muL = 1.0 - muK; 
+
+    double B_sigma = muL * aL - muK * aK; 
+
+    A_Kp[n] = muK * (aKs[n].A + aKs[n].B) + bsigma_plus(B_sigma) / (fK[n] + 1e-15); 
+    A_Lp[n] = muL * (aLs[n].A + aLb[n].B) + bsigma_minus(B_sigma) / (fL[n] + 1e-15); 
   }
-  for (std::size_t j=1; j<m.ny(); ++j) coeff_add_inner(m.nx()-1,j,m.inbr_jm());
-  for (std::size_t j=0; j<m.ny()-1; ++j) coeff_add_inner(m.nx()-1,j,m.inbr_jp());
+}
 
-  // col j = 0
-  for (std::size_t i=0; i<m.nx(); ++i) {
-    coeff_add_inner(i,0,m.inbr_jp()); 
-    coeff_add_dirbc(i,0,m.inbr_jm()); 
-  }
+// The kind of each edge follows from the position of the cell and Bc; 
+// slot_ only gives the positions in M_. inbr 0, 1, 2, 3 are the im, jp, 
+// ip, jm edges of Mesh. 
+template <class Bc>
+void Solver::assemble_cell(int i, int j){
+  const int nx = m.nx(); 
+  const int ny = m.ny(); 
 
-  for (std::size_t i=1; i<m.nx(); ++i) coeff_add_inner(i,0,m.inbr_im());
-  for (std::size_t i=0; i<m.nx()-1; ++i) coeff_add_inner(i,0,m.inbr_ip());
+  if (i > 0) coeff_add_inner<0>(i, j); 
+  else if (Bc::kDirichletIm) coeff_add_dirbc<0>(i, j); 
 
-  // col j == ny-1
-  for (std::size_t i=0; i<m.nx(); ++i) {
-    coeff_add_inner(i,m.ny()-1,m.inbr_jm()); 
-    coeff_add_dirbc(i,m.ny()-1,m.inbr_jp()); 
+  if (j < ny-1) coeff_add_inner<1>(i, j); 
+  else coeff_add_dirbc<1>(i, j); 
+
+  if (i < nx-1) coeff_add_inner<2>(i, j); // nothing special for alpha=90 
+
+  if (j > 0) coeff_add_inner<3>(i, j); 
+  else coeff_add_dirbc<3>(i, j); 
+
+  long ii = m.ind2to1(i,j);
+  M_.valuePtr()[diag_slot_(ii)] += c0_ * mass_(ii); 
+  R_(ii) += mass_(ii) * h_(i,j);
+}
+
+template <class Bc>
+void Solver::assemble_cells(){
+
+  double* val = M_.valuePtr(); 
+  std::fill(val, val + M_.nonZeros(), 0.0); 
+
+  const int nx = m.nx(); 
+  const int ny = m.ny(); 
+
+  // Each cell only writes to its own row of M and R, so the rows can be 
+  // filled in parallel and the result does not depend on the number of threads. 
+  // The inner cells of a row j are done in batches: the fluxes of each 
+  // inbr with inner_fluxes, then added to the rows of M in the order of 
+  // inbr, which gives the same sums as assemble_cell. 
+  #pragma omp parallel
+  {
+    std::vector<double> A_K(4*nx), A_L(4*nx); 
+
+    #pragma omp for schedule(static)
+    for (int j=0; j<ny; ++j) {
+      if (j == 0 || j == ny-1 || nx < 3) {
+        for (int i=0; i<nx; ++i) assemble_cell<Bc>(i, j); 
+        continue; 
+      }
+
+      assemble_cell<Bc>(0, j); 
+
+      int n = nx - 2; 
+      inner_fluxes<0>(j, 1, nx-1, &A_K[0], &A_L[0]); 
+      inner_fluxes<1>(j, 1, nx-1, &A_K[n], &A_L[n]); 
+      inner_fluxes<2>(j, 1, nx-1, &A_K[2*n], &A_L[2*n]); 
+      inner_fluxes<3>(j, 1, nx-1, &A_K[3*n], &A_L[3*n]); 
+
+      for (int k=0; k<n; ++k) {
+        int i = k + 1; 
+        long ii = m.ind2to1(i,j); 
+
+        val[diag_slot_(ii)] += ((A_K[k] + A_K[n+k]) + A_K[2*n+k]) + A_K[3*n+k]; 
+        val[slot_(i,j,0)] -= A_L[k]; 
+        val[slot_(i,j,1)] -= A_L[n+k]; 
+        val[slot_(i,j,2)] -= A_L[2*n+k]; 
+        val[slot_(i,j,3)] -= A_L[3*n+k]; 
+
+        val[diag_slot_(ii)] += c0_ * mass_(ii); 
+        R_(ii) += mass_(ii) * h_(i,j);
+      }
+
+      assemble_cell<Bc>(nx-1, j); 
+    }
   }
+}
 
-  for (std::size_t i=1; i<m.nx(); ++i) coeff_add_inner(i,m.ny()-1,m.inbr_im());
-  for (std::size_t i=0; i<m.nx()-1; ++i) coeff_add_inner(i,m.ny()-1,m.inbr_ip());
 
-  double a0, p;
-  long ii;
-  double Uii;
+bool Solver::pattern_changed() const {
+  if (M_.outerSize() + 1 != (long)pattern_outer_.size() || M_.nonZeros() != (long)pattern_inner_.size())
+    return true; 
 
-  for (std::size_t i=0; i<m.nx(); ++i) {
-    a0 = m.x(i);
-    for (std::size_t j=0; j<m.ny(); ++j) {
-      p = m.p(j);
-      ii = m.ind2to1(i,j);
-      Uii = G(a0, p) * m.area_dt();
-      M_coeffs_.push_back(T(ii, ii, Uii));
-      R_(ii) += Uii * f_(i,j);
+  return !std::equal(pattern_outer_.begin(), pattern_outer_.end(), M_.outerIndexPtr()) ||
+         !std::equal(pattern_inner_.begin(), pattern_inner_.end(), M_.innerIndexPtr()); 
+}
+
+void Solver::save_pattern() {
+  pattern_outer_.assign(M_.outerIndexPtr(), M_.outerIndexPtr() + M_.outerSize() + 1); 
+  pattern_inner_.assign(M_.innerIndexPtr(), M_.innerIndexPtr() + M_.nonZeros()); 
+  pattern_analyzed_ = true; 
+}
+
+void Solver::update_mass(double dt){
+  if (dt == mass_dt_) return; 
+
+  mass_ = G_ / dt; 
+  mass_dt_ = dt; 
+}
+
+// The BDF2 matrix has the same sign structure as the backward Euler one, 
+// so f^{n+1} >= 0 as long as the history h_ >= 0 and the f the nonlinear 
+// fluxes are evaluated at is >= 0. Where f drops by more than a factor 
+// (1+w)^2/w^2 in one step h_ would be negative; such a step is taken with 
+// backward Euler instead. Returns true for a BDF2 step. 
+bool Solver::set_history(double dt){
+  if (bdf2_ && dt_prev_ > 0) {
+    double w = dt / dt_prev_; 
+    double c1 = 1 + w; 
+    double c2 = w * w / (1 + w); 
+
+    h_ = c1 * f_ - c2 * f_prev_; 
+    if (h_.minCoeff() >= 0) {
+      c0_ = (1 + 2*w) / (1 + w); 
+      return true; 
     }
   }
 
-  M_.setFromTriplets(M_coeffs_.begin(), M_coeffs_.end());
+  c0_ = 1.0; 
+  h_ = f_; 
+  return false; 
 }
 
+void Solver::save_state(State* sp) const {
+  sp->t = t_; 
+  sp->f = f_; 
+  sp->f_prev = f_prev_; 
+  sp->dt_prev = dt_prev_; 
+  sp->vertex_f = vertex_f_; 
+}
+
+void Solver::restore_state(const State& s){
+  t_ = s.t; 
+  f_ = s.f; 
+  f_prev_ = s.f_prev; 
+  dt_prev_ = s.dt_prev; 
+  vertex_f_ = s.vertex_f; 
+}
 
 void Solver::update() {
-  R_.setZero();
-  M_coeffs_.clear();
+  update(m.dt()); 
+}
+
+void Solver::solve_step(Eigen::VectorXd* xp) {
+  {
+    Scoped_timer timer(prof_, Profiler::kAssemble); 
+    R_.setZero();
+    assemble(); 
+  }
+
+  if (!pattern_analyzed_ || pattern_changed()) { // e.g., first step or remesh
+    Scoped_timer timer(prof_, Profiler::kAnalyze); 
+    lsolver_->analyze(M_);
+    save_pattern(); 
+  }
+
+  {
+    Scoped_timer timer(prof_, Profiler::kFactorize); 
+    lsolver_->factorize(M_);
+  }
+
+  {
+    Scoped_timer timer(prof_, Profiler::kSolve); 
+    lsolver_->solve(R_, xp); 
+  }
+
+  if (prof_) { // one more product with M, only when profiling
+    double Rnorm = R_.norm(); 
+    prof_->add_solve(M_.nonZeros(), lsolver_->factor_nonzeros(), 
+        (R_ - M_ * (*xp)).norm() / (Rnorm > 0 ? Rnorm : 1.0)); 
+  }
+}
+
+// Anderson accelerated fixed point iteration for M(f) f = R(f), with the 
+// fluxes of M and R evaluated at f. The map is 
+//   g(x) = x + M0^{-1} (R(x) - M(x) x), 
+// where M0^{-1} is lsolver_ as set up by the first solve of the step: the 
+// factors of M0 for the direct solvers, or a solve with the current M_ 
+// preconditioned with M0 for the iterative ones. The iterates are kept 
+// >= 0 so that the fluxes stay positive. 
+void Solver::iterate_nonlinear(Eigen::VectorXd* xp) {
+  Eigen::VectorXd& x = *xp; 
+  long n = x.size(); 
+  int depth = paras.anderson_depth(); 
+
+  Eigen::MatrixXd dX(n, depth), dG(n, depth); // differences of x and of r = g(x) - x
+  Eigen::VectorXd g(n), r(n), dx(n), x_old, r_old; 
+  int ncols = 0; 
+
+  x = x.cwiseMax(0.0); 
+  nonlinear_iterations_ = 0; 
+  nonlinear_error_ = 0.0; 
+
+  for (int k = 1; k <= paras.nonlinear_maxit(); ++k) {
+    f_star_.reshaped() = x; 
+    f_lin_ = &f_star_; 
+    update_vertex_f(f_star_); 
+
+    R_.setZero(); 
+    assemble(); 
+
+    dx.setZero(); 
+    lsolver_->solve(R_ - M_ * x, &dx); 
+    g = x + dx; 
+    r = dx; 
+
+    nonlinear_iterations_ = k; 
+    nonlinear_error_ = r.lpNorm<Eigen::Infinity>() / std::max(g.lpNorm<Eigen::Infinity>(), 1e-300); 
+    if (nonlinear_error_ <= paras.nonlinear_tol()) {
+      x = g.cwiseMax(0.0); 
+      return; 
+    }
+
+    if (depth > 0) {
+      if (k > 1) { // keep the last depth differences, oldest first
+        if (ncols == depth) {
+          dX.leftCols(depth-1) = dX.rightCols(depth-1).eval(); 
+          dG.leftCols(depth-1) = dG.rightCols(depth-1).eval(); 
+          --ncols; 
+        }
+        dX.col(ncols) = x - x_old; 
+        dG.col(ncols) = r - r_old; 
+        ++ncols; 
+      }
+      x_old = x; 
+      r_old = r; 
+    }
 
-  assemble(); 
+    if (ncols > 0) {
+      // minimize |r - dG gamma| and combine the previous g's accordingly
+      Eigen::VectorXd gamma = dG.leftCols(ncols).colPivHouseholderQr().solve(r); 
+      x = g - (dX.leftCols(ncols) + dG.leftCols(ncols)) * gamma; 
+    }
+    else {
+      x = g; 
+    }
+    x = x.cwiseMax(0.0); 
+  }
+}
 
-  solver.analyzePattern(M_);
-  solver.factorize(M_);
-  f_.reshaped() = solver.solve(R_);
+void Solver::update(double dt) {
+  {
+    Scoped_timer timer(prof_, Profiler::kAlphaOsf); 
+    update_alpha_osf(); 
+  }
+  update_mass(dt); 
+
+  f_lin_ = &f_; 
+  Eigen::VectorXd x = f_.reshaped(); // the previous f is the initial guess
+  bool bdf2_step = set_history(dt); 
+  solve_step(&x); 
+
+  if (paras.nonlinear_iterate()) {
+    Scoped_timer timer(prof_, Profiler::kNonlinear); 
+    iterate_nonlinear(&x); 
+  }
+  else if (bdf2_step) {
+    // evaluate the fluxes at the predictor, which is >= 0 up to round-off
+    f_star_.reshaped() = x; 
+    f_star_ = f_star_.cwiseMax(0.0); 
+    f_lin_ = &f_star_; 
+    {
+      Scoped_timer timer(prof_, Profiler::kVertexF); 
+      update_vertex_f(f_star_); 
+    }
+
+    solve_step(&x); 
+  }
+
+  if (bdf2_) {
+    f_prev_ = f_; 
+    dt_prev_ = dt; 
+  }
+
+  f_.reshaped() = x; 
 
   if (paras.alpha0_min_bct() == 0) {
+    #pragma omp parallel for schedule(static)
     for (std::size_t i=0; i<m.nx(); ++i)
       for (std::size_t j=0; j<m.ny(); ++j) {
-        f_(i,j) *= exp(-m.dt()/tau_(i,j)); 
+        f_(i,j) *= exp(-dt/tau_(i,j)); 
       }
   }
 
-  t_ += m.dt(); 
-  construct_alpha_osf();
+  t_ += dt; 
+
+  Scoped_timer timer(prof_, Profiler::kVertexF); 
   update_vertex_f();
 }
 
 void Solver::update_vertex_f(){
-  for (std::size_t i=1; i<m.nx(); ++i)
-    for (std::size_t j=1; j<m.ny(); ++j){
-      vertex_f_(i,j) = (f_(i-1,j-1) + f_(i-1,j) + f_(i,j-1) + f_(i,j)) / 4.0; 
+  update_vertex_f(f_); 
+}
+
+void Solver::update_vertex_f(const Eigen::MatrixXd& f){
+  #pragma omp parallel for schedule(static)
+  for (std::size_t j=1; j<m.ny(); ++j){
+    double wy = vertex_wy_(j); 
+
+    #pragma omp simd
+    for (std::size_t i=1; i<m.nx(); ++i){
+      double wx = vertex_wx_(i); 
+      vertex_f_(i,j) = (1-wx) * ((1-wy) * f(i-1,j-1) + wy * f(i-1,j)) + wx * ((1-wy) * f(i,j-1) + wy * f(i,j)); 
     }
+  }
 
   double a0;
 
@@ -280,14 +622,14 @@ void Solver::update_vertex_f(){
   else {
     double y, p; 
     for (std::size_t j = 1; j<m.ny(); ++j){
-      y = m.yO() + j*m.dy();
+      y = m.yv(j);
       p = std::exp(y); 
       vertex_f_(0,j) = bcs.alpha0_lc(t(), p);
     }
   }
   // j == 0  and j == m.ny() boundary
   for (std::size_t i = 0; i <= m.nx(); ++i) {
-    a0 = m.xO() + i*m.dx(); 
+    a0 = m.xv(i); 
     vertex_f_(i,0) = bcs.pmin(t(), a0); 
     vertex_f_(i,m.ny()) = bcs.pmax(t(), a0); 
   }
@@ -16,7 +16,10 @@
 #include "D.h"
 #include "BCs.h"
 #include "Parameters.h"
+#include "Linear_solver.h"
+#include "Profiler.h"
 #include <vector>
+#include <memory>
 #include "xtensor/xtensor.hpp"
 #include "xtensor/xio.hpp"
 
@@ -26,15 +29,84 @@ struct NTPFA_node{ // two points A,B used in Nonlinear Two Point Approximation
   double B;
 }; 
 
+// The boundary conditions at alpha0_min (alpha0_min_bct in p.ini), as 
+// compile time policies of the assembly. 
+struct Bc_loss_cone { // f = 0 at alpha0_LC
+  static const bool kDirichletIm = true; 
+}; 
+
+struct Bc_zero_slope { // df/da0 = 0 at alpha0 = 0
+  static const bool kDirichletIm = false; 
+}; 
+
 class Solver {
   public:
     Solver(const Parameters& paras_in, const Mesh& m_in, const D& d_in, const BCs& bcs_in);
 
-    void update();
+    void update();          // a step of m.dt()
+    void update(double dt); // a step of dt
     double t() const { return t_; }
     const Eigen::MatrixXd& f() const { return f_; }
 
+    // everything that changes with time steps, to retake a rejected step
+    struct State {
+      double t; 
+      Eigen::MatrixXd f; 
+      Eigen::MatrixXd f_prev; 
+      double dt_prev; 
+      Eigen::MatrixXd vertex_f; 
+    }; 
+
+    void save_state(State* sp) const; 
+    void restore_state(const State& s); 
+
+    // statistics of the nonlinear iteration of the last step, if enabled: 
+    // the number of iterations and the last relative change of f 
+    int nonlinear_iterations() const { return nonlinear_iterations_; }
+    double nonlinear_error() const { return nonlinear_error_; }
+
+    // times the phases of the steps into *pp; null (the default) for no timing
+    void set_profiler(Profiler* pp) { prof_ = pp; }
+
+    // The pieces of the scheme that do not depend on the mesh layout, 
+    // shared with Amr_solver. 
+    static void alpha_osf_func(const Eigen::Matrix2d& Lambda_K, const Point& K, const Point& A, const Point& B, NTPFA_node* nodep);
+
+    // alpha_osf_func for the four edges of an axis-aligned hx x hy cell with 
+    // K at its center, Lambda_K = [a b; b c], in inbr order into nodes[0..3]
+    static void alpha_osf_rect(double a, double b, double c, double hx, double hy, NTPFA_node* nodes){
+      double rx = a * hy / hx; 
+      double ry = c * hx / hy; 
+      nodes[0].A = rx - b;  nodes[0].B = rx + b;  // im 
+      nodes[1].A = ry + b;  nodes[1].B = ry - b;  // jp 
+      nodes[2].A = rx - b;  nodes[2].B = rx + b;  // ip 
+      nodes[3].A = ry + b;  nodes[3].B = ry - b;  // jm 
+    }
+
+    // without branches, so that it vectorizes: the select is a blend
+    static double coeff_mu(double aK, double aL) {
+      double s = std::abs(aK) + std::abs(aL); 
+      return s > 0 ? std::abs(aL) / s : 0.5; 
+    }
+
+    static double bsigma_plus(double bsigma){
+      return (std::abs(bsigma) + bsigma)/2.0;
+    }
+
+    static double bsigma_minus(double bsigma){
+      return (std::abs(bsigma) - bsigma)/2.0;
+    }
+
+    static double G(double alpha, double p){ // this is the Jacobian for (a0, log(p))
+      double T = 1.30 - 0.56 * sin(alpha);
+      return p * p * p * T * sin(alpha) * cos(alpha);
+    }
+
+    static double bounce_period(double L, double a, double p); 
+
   private:
+    friend class Solver_bench; // times the phases of update (bench/bench.cc)
+
     const Parameters& paras; 
     const Mesh& m;
     const D& d; 
@@ -42,65 +114,125 @@ class Solver {
 
     double t_; 
 
+    Profiler* prof_; 
+
     // M f = R
-    Eigen::SparseLU<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>> solver;
+    std::unique_ptr<Linear_solver> lsolver_;
 
     SpMat M_;
-    std::vector<T> M_coeffs_;
+
+    // Direct assembly into the compressed storage of M_. 
+    // slot_(i,j,inbr) is the position in M_.valuePtr() of the entry 
+    // (cell (i,j), its inbr neighbor) or one of the boundary tags below.
+    // diag_slot_(ii) is the position of the diagonal entry of row ii.
+    static const int kSlotDirbc = -1; // the neighbor is a Dirichlet boundary
+    static const int kSlotNone = -2;  // no flux through this edge
+    xt::xtensor<int,3,xt::layout_type::column_major> slot_; 
+    Eigen::VectorXi diag_slot_; 
+
+    // the mass term G*area/dt of each cell, computed for the time step mass_dt_
+    Eigen::VectorXd G_; // G*area
+    Eigen::VectorXd mass_; 
+    double mass_dt_; 
+
+    void update_mass(double dt); 
+
+    // Variable step BDF2 with w = dt/dt_prev_: 
+    //   c0 f^{n+1} - c1 f^n + c2 f^{n-1} = dt * (flux terms), 
+    //   c0 = (1+2w)/(1+w), c1 = 1+w, c2 = w^2/(1+w). 
+    // Backward Euler is c0 = c1 = 1, c2 = 0. The diagonal gets c0*mass_ and 
+    // the right hand side mass_*(c1 f^n - c2 f^{n-1}) = mass_*h_. 
+    bool bdf2_; 
+    Eigen::MatrixXd f_prev_; // f^{n-1}
+    double dt_prev_;         // 0 until a step has been taken
+    double c0_; 
+    Eigen::MatrixXd h_; 
+
+    // The f the nonlinear fluxes are evaluated at. Backward Euler uses f^n. 
+    // With f^n the BDF2 step would only be first order, so a BDF2 step is 
+    // solved twice: once with the fluxes at f^n, which gives the predictor 
+    // f_star_, and again with the fluxes at f_star_. vertex_f_ is computed 
+    // from *f_lin_. 
+    Eigen::MatrixXd f_star_; 
+    const Eigen::MatrixXd* f_lin_; 
+
+    bool set_history(double dt); 
+
+    // assemble M_ and R_, factorize M_ and solve, with *xp as the initial guess
+    void solve_step(Eigen::VectorXd* xp); 
+
+    // iterate the step to convergence of the fluxes, starting from *xp 
+    void iterate_nonlinear(Eigen::VectorXd* xp); 
+    int nonlinear_iterations_; 
+    double nonlinear_error_; 
+
+    // The sparsity pattern M_ was last analyzed with. The symbolic
+    // analysis of lsolver_ is reused as long as it matches.
+    bool pattern_analyzed_; 
+    std::vector<SpMat::StorageIndex> pattern_outer_; 
+    std::vector<SpMat::StorageIndex> pattern_inner_; 
 
     Eigen::MatrixXd f_;
     Eigen::VectorXd R_;
 
     Eigen::MatrixXd tau_; 
 
-    xt::xtensor<NTPFA_node,3> alpha_osf_; // alpha_one_sided_flux
+    // The arrays per cell are column major like f_ and M_, so that the 
+    // cells (i,j) of a row j are contiguous for the vectorized loops over i. 
+    xt::xtensor<NTPFA_node,3,xt::layout_type::column_major> alpha_osf_; // alpha_one_sided_flux
 
     //
     // use a matrix to store f at vertices to build a lookup 
     // table for fA and fB
     // vertex_f is of size (nx+1, ny+1)
     // 
-    xt::xtensor<double,2> vertex_f_; 
+    Eigen::MatrixXd vertex_f_; 
+
+    // bilinear weights of cells i and j at the inner vertex (i,j); 
+    // 1/2 on uniform grids
+    Eigen::VectorXd vertex_wx_; 
+    Eigen::VectorXd vertex_wy_; 
 
     void update_vertex_f(); 
+    void update_vertex_f(const Eigen::MatrixXd& f); 
 
+    void build_pattern(); 
     void assemble();
 
+    // The assembly for the boundary condition policy Bc, chosen once in the 
+    // constructor from a table indexed by alpha0_min_bct. 
+    template <class Bc> void assemble_cells(); 
+    void (Solver::*assemble_cells_)(); 
+
+    // one cell, for the cells on the boundary of the mesh
+    template <class Bc> void assemble_cell(int i, int j); 
+
+    // The coefficients A_K and A_L of coeff_add_inner for the inbr edges of 
+    // the cells (i,j), i0 <= i < i1, into A_Kp[i-i0], A_Lp[i-i0], in one 
+    // vectorized loop. All their inbr neighbors have to be inner cells. 
+    template <int inbr> void inner_fluxes(int j, int i0, int i1, double* A_Kp, double* A_Lp) const; 
+
+    bool pattern_changed() const; 
+    void save_pattern(); 
+
+    // the version of d that alpha_osf_ was constructed from
+    std::size_t d_version_; 
+
     void construct_alpha_osf();
-    void alpha_osf_func(const Eigen::Matrix2d& Lambda_K, const Point& K, const Point& A, const Point& B, NTPFA_node* nodep);
+    void construct_alpha_osf(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1); 
+    void update_alpha_osf(); 
 
-    // add coefficients to M and R corresponds to the inbr cell of cell (i,j)
+    // add coefficients to M and R corresponds to the inbr cell of cell (i,j); 
+    // inbr is a template parameter so that the neighbor and vertex offsets 
+    // are constants. 
     // Here: the inbr neighbor is an inner cell.
-    void coeff_add_inner(int i, int j, int inbr);  
+    template <int inbr> void coeff_add_inner(int i, int j);  
   
     // Here: the inbr neighbor is a Dirichlet boundary cell.
-    void coeff_add_dirbc(int i, int j, int inbr); 
-
-    double coeff_mu(double aK, double aL) const {
-      if (aK != 0 || aL != 0){
-        return abs(aL) / (abs(aK) + abs(aL));
-      } else {
-        return 0.5;
-      }
-    }
-
-    double bsigma_plus(double bsigma){
-      return (std::abs(bsigma) + bsigma)/2.0;
-    }
-
-    double bsigma_minus(double bsigma){
-      return (std::abs(bsigma) - bsigma)/2.0;
-    }
-
-    double G(double alpha, double p){ // this is the Jacobian for (a0, log(p))
-      double T = 1.30 - 0.56 * sin(alpha);
-      return p * p * p * T * sin(alpha) * cos(alpha);
-    }
+    template <int inbr> void coeff_add_dirbc(int i, int j); 
 
     void init();
 
-    double bounce_period(double a, double p) const; 
-
 };
 
 #endif /* SOLVER_H */
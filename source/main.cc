@@ -13,67 +13,54 @@
 #include "Parameters.h"
 #include "Mesh.h"
 #include "D.h"
-#include "BCs.h"
-#include "Solver.h"
+#include "Simulation.h"
+#include "Ensemble.h"
 #include "utils.h"
 #include <ctime>
+#include <chrono>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 int main(int argc, char** argv) {
 
+  // ./fvm2d sweep.ini runs an ensemble if sweep.ini has an [ensemble] section
+  if (argc == 2 && Ensemble::is_spec(argv[1])) {
+    Ensemble ensemble(argv[1]); 
+    ensemble.run(); 
+    return 0; 
+  }
+
   Parameters paras(argc,argv); 
 
+#ifdef _OPENMP
+  omp_set_num_threads(paras.nthreads()); 
+#endif
+
+  // Wall time, on a monotonic clock; with several threads the CPU time of 
+  // clock() is the sum over the threads. 
+  typedef std::chrono::steady_clock Clock; 
+  Clock::time_point wall_start = Clock::now(); 
+  clock_t start = clock(); 
+
   // Create mesh 
   Mesh m(paras);
 
   // Create diffusion coefficients object
   D diffusion(paras, m);
 
-  BCs boundary(paras);
-
-  Solver solver(paras, m, diffusion, boundary);
-
-  string filename;
-  ofstream out; 
+  Simulation simulation(paras, m, diffusion); 
 
-  Eigen::VectorXd a0(m.nx()), E(m.ny()); 
+  Clock::time_point wall_run = Clock::now(); 
 
-  // output coordinates 
-  filename = paras.output_path() + "/" + paras.run_id() + "_a0.dat";
-  out.open(filename); 
-  assert(out);
-  a0 = m.x() * 180.0/gPI; 
-  out << a0 << std::endl;  
-  out.close();
+  simulation.run(); 
 
-  filename = paras.output_path() + "/" + paras.run_id() + "_E.dat";
-  out.open(filename); 
-  assert(out);
-  for (std::size_t i=0; i<m.ny(); ++i) E(i) = p2e(m.p(i), gE0);
-  out << E << std::endl;  
-  out.close();
-
-  // The timer
-  clock_t start, end;
-  double cpu_time;
-  start = clock();
-
-  // Time loop for solving
-  for (int k = 1; k <= paras.nsteps(); ++k) {
-
-    // Solve using FVM solver
-    solver.update();
-
-    if(k % paras.save_every_step() == 0){
-      filename = paras.output_path() + "/" + paras.run_id() + std::to_string(int((k) / paras.save_every_step()));
-      out.open(filename);
-      out << solver.f(); 
-      out.close();
-    }
-  }
-  end = clock();
-  cpu_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+  Clock::time_point wall_end = Clock::now(); 
+  double cpu_time = ((double) (clock() - start)) / CLOCKS_PER_SEC;
+  std::cout << "Wall time used " << std::chrono::duration<double>(wall_end - wall_start).count() 
+    << " seconds (setup " << std::chrono::duration<double>(wall_run - wall_start).count() 
+    << ", run " << std::chrono::duration<double>(wall_end - wall_run).count() << ")" << std::endl;
   std::cout << "CPU time used " << cpu_time << " seconds" << std::endl;
 
   return 0;
 }
-